@@ -1,3 +0,0 @@
-#include "bilateral_denoise.hpp"
-
-HALIDE_REGISTER_GENERATOR(BilateralDenoise, bilateral_denoise)
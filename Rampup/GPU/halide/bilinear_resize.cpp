@@ -1,3 +0,0 @@
-#include "bilinear_resize.hpp"
-
-HALIDE_REGISTER_GENERATOR(BilinearResize, bilinear_resize)
@@ -1,3 +0,0 @@
-#include "black_level_subtraction.hpp"
-
-HALIDE_REGISTER_GENERATOR(BlackLevelSubtraction, black_level_subtraction)
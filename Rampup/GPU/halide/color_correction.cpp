@@ -1,3 +0,0 @@
-#include "color_correction.hpp"
-
-HALIDE_REGISTER_GENERATOR(ColorCorrection, color_correction)
@@ -1,3 +0,0 @@
-#include "demosaic.hpp"
-
-HALIDE_REGISTER_GENERATOR(Demosaic, demosaic)
@@ -1,3 +0,0 @@
-#include "denormalization.hpp"
-
-HALIDE_REGISTER_GENERATOR(Denormalization, denormalization)
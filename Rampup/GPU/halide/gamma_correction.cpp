@@ -1,3 +0,0 @@
-#include "gamma_correction.hpp"
-
-HALIDE_REGISTER_GENERATOR(GammaCorrection, gamma_correction)
@@ -1,3 +0,0 @@
-#include "isp.hpp"
-
-HALIDE_REGISTER_GENERATOR(ISP, isp)
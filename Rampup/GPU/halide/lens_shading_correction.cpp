@@ -1,3 +0,0 @@
-#include "lens_shading_correction.hpp"
-
-HALIDE_REGISTER_GENERATOR(LensShadingCorrection, lens_shading_correction)
@@ -1,3 +0,0 @@
-#include "mix.hpp"
-
-HALIDE_REGISTER_GENERATOR(Mix, mix)
@@ -1,3 +0,0 @@
-#include "normalization.hpp"
-
-HALIDE_REGISTER_GENERATOR(Normalization, normalization)
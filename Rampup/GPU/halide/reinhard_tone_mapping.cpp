@@ -1,3 +0,0 @@
-#include "reinhard_tone_mapping.hpp"
-
-HALIDE_REGISTER_GENERATOR(ReinhardToneMapping, reinhard_tone_mapping)
@@ -1,3 +0,0 @@
-#include "rgb_to_ycbcr.hpp"
-
-HALIDE_REGISTER_GENERATOR(RGB2YCbCr, rgb_to_ycbcr)
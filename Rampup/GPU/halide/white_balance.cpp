@@ -1,3 +0,0 @@
-#include "white_balance.hpp"
-
-HALIDE_REGISTER_GENERATOR(WhiteBalance, white_balance)
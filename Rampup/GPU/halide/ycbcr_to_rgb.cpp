@@ -1,3 +0,0 @@
-#include "ycbcr_to_rgb.hpp"
-
-HALIDE_REGISTER_GENERATOR(YCbCr2RGB, ycbcr_to_rgb)
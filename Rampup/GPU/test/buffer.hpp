@@ -3,6 +3,14 @@
 
 #include "HalideBuffer.h"
 
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
 #if defined(HALIDE_RUNTIME_OPENCL)
     #define IS_DEVICE     true
     #define INTERFACE     halide_opencl_device_interface()
@@ -20,23 +28,152 @@
 namespace {
     using namespace Halide::Runtime;
 
+    // Accounting of copy_to_gpu and copy_to_cpu by stage (account_stage): calls, transfers (the calls that moved
+    // data), bytes and time of the transfers, and time of the runs of the stage. With the host fallback
+    // (INTERFACE nullptr) the calls are counted and nothing is transferred. The table is printed at exit.
+    struct TransferStats {
+        int runs = 0;
+        int calls = 0;
+        int transfers = 0;
+        size_t bytes = 0;
+        double transfer_ms = 0.0;
+        double total_ms = 0.0;
+    };
+
+    struct TransferAccounting {
+        std::vector<std::pair<std::string, TransferStats>> stages; // in the order of their first run
+        TransferStats * current = nullptr;
+
+        TransferStats & stage(const std::string & name) {
+            for(auto & stage : stages) {
+                if(stage.first == name) {
+                    return stage.second;
+                }
+            }
+            stages.emplace_back(name, TransferStats());
+            return stages.back().second;
+        }
+
+        ~TransferAccounting() {
+            if(stages.empty()) {
+                return;
+            }
+            printf("%-24s %6s %8s %10s %10s %14s %14s %14s\n", "stage", "runs", "calls", "transfers", "MB",
+                "transfer ms", "compute ms", "MB/s");
+            for(auto & stage : stages) {
+                const TransferStats & t = stage.second;
+                const int runs = (t.runs > 0) ? t.runs : 1; // totals out of the stages
+                const double compute_ms = (t.runs > 0) ? (t.total_ms - t.transfer_ms) / runs : 0.0;
+                printf("%-24s %6d %8d %10d %10.2f %14.3f %14.3f %14.1f\n", stage.first.c_str(), t.runs, t.calls,
+                    t.transfers, t.bytes / 1e6, t.transfer_ms / runs, compute_ms,
+                    (t.transfer_ms > 0.0) ? t.bytes / 1e3 / t.transfer_ms : 0.0);
+            }
+        }
+    };
+
+    inline TransferAccounting & transfer_accounting() {
+        static TransferAccounting accounting;
+        return accounting;
+    }
+
+    // stats of the current stage, of "other" out of account_stage
+    inline TransferStats & transfer_stats() {
+        TransferAccounting & accounting = transfer_accounting();
+        return accounting.current ? *accounting.current : accounting.stage("other");
+    }
+
+    // op accounted to stage: the transfers in it and the time of each run (transfer ms per run, the rest as
+    // compute ms per run)
+    template<typename F>
+    std::function<void()> account_stage(const char * stage, F op) {
+        return [stage, op]() {
+            TransferAccounting & accounting = transfer_accounting();
+            TransferStats & stats = accounting.stage(stage);
+            TransferStats * previous = accounting.current;
+            accounting.current = &stats;
+            auto start = std::chrono::high_resolution_clock::now();
+            op();
+            auto end = std::chrono::high_resolution_clock::now();
+            stats.total_ms += std::chrono::duration<double, std::milli>(end - start).count();
+            stats.runs++;
+            accounting.current = previous;
+        };
+    }
+
+    template<typename F>
+    static inline void account_transfer(size_t bytes, bool transfer, F copy) {
+        TransferStats & stats = transfer_stats();
+        auto start = std::chrono::high_resolution_clock::now();
+        copy();
+        auto end = std::chrono::high_resolution_clock::now();
+        stats.calls++;
+        if(transfer) {
+            stats.transfers++;
+            stats.bytes += bytes;
+            stats.transfer_ms += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+    }
+
+    // Host to device transfer when the host is dirty, or on the first call (no device allocation yet), or with
+    // force. The host of a buffer written through operator() is marked dirty by it; a buffer written through
+    // data() must be marked with set_host_dirty().
     template<typename T>
     static inline void copy_to_gpu(
         Buffer<T> & buffer,
-        const struct halide_device_interface_t * device_interface
+        const struct halide_device_interface_t * device_interface,
+        bool force = false
     ) {
-        if(device_interface != nullptr) {
+        if(device_interface == nullptr) {
+            account_transfer(0, false, []() {});
+            return;
+        }
+        if(force || !buffer.has_device_allocation()) {
             buffer.set_host_dirty();
-            buffer.copy_to_device(device_interface);
         }
+        account_transfer(buffer.size_in_bytes(), buffer.host_dirty(), [&]() {
+            buffer.copy_to_device(device_interface);
+        });
     }
 
+    // Device to host transfer when the device is dirty (written by a pipeline) or with force
     template<typename T>
-    static inline void copy_to_cpu(Buffer<T> & buffer) {
-        if(buffer.has_device_allocation()) {
+    static inline void copy_to_cpu(Buffer<T> & buffer, bool force = false) {
+        if(!buffer.has_device_allocation()) {
+            account_transfer(0, false, []() {});
+            return;
+        }
+        if(force) {
             buffer.set_device_dirty();
-            buffer.copy_to_host();
         }
+        account_transfer(buffer.size_in_bytes(), buffer.device_dirty(), [&]() {
+            buffer.copy_to_host();
+        });
+    }
+
+    // Buffers given back by release_buffer, by type, extents, mins and device interface, handed out again by
+    // create_buffer instead of new host or device allocations
+    typedef std::tuple<uint32_t, std::vector<int>, std::vector<int>, const halide_device_interface_t *> BufferKey;
+
+    struct BufferPool {
+        std::map<BufferKey, std::vector<Buffer<>>> buffers;
+        int allocated = 0;
+        int recycled = 0;
+    };
+
+    // never destroyed, the device API may be released before the static objects
+    BufferPool & buffer_pool() {
+        static BufferPool * pool = new BufferPool();
+        return *pool;
+    }
+
+    inline BufferKey buffer_key(
+        halide_type_t type,
+        const struct halide_device_interface_t * device_interface,
+        const std::vector<int> & extents,
+        std::vector<int> mins
+    ) {
+        mins.resize(extents.size(), 0);
+        return BufferKey(type.as_u32(), extents, mins, device_interface);
     }
 
     template<typename T>
@@ -45,6 +182,18 @@ namespace {
         const std::vector<int> & extents,
         const std::vector<int> & mins = {}
     ) {
+        BufferPool & pool = buffer_pool();
+        std::vector<Buffer<>> & free_buffers = pool.buffers[buffer_key(halide_type_of<T>(), device_interface, extents, mins)];
+        if(!free_buffers.empty()) {
+            Buffer<T> buffer = free_buffers.back();
+            free_buffers.pop_back();
+            // the contents are stale, nothing to transfer
+            buffer.set_host_dirty(false);
+            buffer.set_device_dirty(false);
+            pool.recycled++;
+            return buffer;
+        }
+        pool.allocated++;
         if(device_interface != nullptr) {
             Buffer<T> buffer(nullptr, extents);
             buffer.set_min(mins);
@@ -57,11 +206,30 @@ namespace {
         }
     }
 
+    // Gives the allocations of buffer back to the pool, buffer is left empty
     template<typename T>
     static inline void release_buffer(Buffer<T> & buffer) {
-        if(buffer.has_device_allocation()) {
-            buffer.device_free();
+        std::vector<int> extents, mins;
+        for(int i = 0; i < buffer.dimensions(); i++) {
+            extents.push_back(buffer.dim(i).extent());
+            mins.push_back(buffer.dim(i).min());
+        }
+        const halide_device_interface_t * device_interface = buffer.raw_buffer()->device_interface;
+        buffer_pool().buffers[buffer_key(buffer.type(), device_interface, extents, mins)].push_back(buffer);
+        buffer = Buffer<T>();
+    }
+
+    // Frees the buffers of the pool
+    inline void clear_buffer_pool() {
+        BufferPool & pool = buffer_pool();
+        for(auto & free_buffers : pool.buffers) {
+            for(Buffer<> & buffer : free_buffers.second) {
+                if(buffer.has_device_allocation()) {
+                    buffer.device_free();
+                }
+            }
         }
+        pool.buffers.clear();
     }
 }
 
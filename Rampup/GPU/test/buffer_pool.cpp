@@ -0,0 +1,89 @@
+#include "buffer.hpp"
+#include "host_device.hpp"
+
+#include <cstdio>
+
+using namespace Halide::Runtime;
+
+// buffer.hpp on the device of host_device.hpp: the buffers released by a stage are recycled by the next ones,
+// the transfers are skipped when the other side is not dirty and accounted by stage. No GPU nor pipeline is
+// needed.
+
+int failures = 0;
+
+void check(bool condition, const char * what) {
+    printf("%s: %s\n", condition ? "ok" : "FAILED", what);
+    failures += !condition;
+}
+
+int main() {
+    const halide_device_interface_t * device_interface = host_device_interface();
+    const HostDeviceStats & stats = host_device_stats;
+    const int width = 64;
+    const int height = 48;
+
+    Buffer<float> input(width, height);
+    input.fill(0.5f);
+    copy_to_gpu(input, device_interface);
+    check((stats.mallocs == 1) && (stats.to_device == 1), "first copy_to_gpu allocates and transfers");
+    copy_to_gpu(input, device_interface);
+    check(stats.to_device == 1, "copy_to_gpu of a clean host is skipped");
+    input(0, 0) = 1.f;
+    copy_to_gpu(input, device_interface);
+    check(stats.to_device == 2, "copy_to_gpu after a write of the host transfers");
+    copy_to_gpu(input, device_interface, true);
+    check(stats.to_device == 3, "copy_to_gpu with force transfers");
+
+    // the intermediates of test.hpp: released as soon as the next stages have read them
+    for(int run = 0; run < 2; run++) {
+        Buffer<float> im_norm = create_buffer<float>(device_interface, {width, height});
+        Buffer<float> im_bls = create_buffer<float>(device_interface, {width, height});
+        release_buffer(im_norm);
+        Buffer<float> im_lsc = create_buffer<float>(device_interface, {width, height});
+        release_buffer(im_bls);
+        Buffer<float> im_dms = create_buffer<float>(device_interface, {width, height, 3});
+        release_buffer(im_lsc);
+        Buffer<float> im_dns = create_buffer<float>(device_interface, {width, height, 2}, {0, 0, 1});
+        Buffer<float> im_mix = create_buffer<float>(device_interface, {width, height, 3});
+        release_buffer(im_dms);
+        release_buffer(im_dns);
+        Buffer<float> im_cc = create_buffer<float>(device_interface, {width, height, 3});
+        check(im_cc.dim(2).min() == 0, "recycled buffer has the requested mins");
+        release_buffer(im_mix);
+        release_buffer(im_cc);
+    }
+    check(stats.mallocs == 1 + 5, "device allocations of the second run recycled");
+    check((buffer_pool().allocated == 5) && (buffer_pool().recycled == 9), "pool counts");
+
+    Buffer<float> output(width, height, 3);
+    copy_to_gpu(output, device_interface);
+    const int to_host = stats.to_host;
+    output.set_device_dirty(); // written by a pipeline
+    copy_to_cpu(output);
+    check(stats.to_host == to_host + 1, "copy_to_cpu of a dirty device transfers");
+    copy_to_cpu(output);
+    check(stats.to_host == to_host + 1, "copy_to_cpu of a clean device is skipped");
+    copy_to_cpu(output, true);
+    check(stats.to_host == to_host + 2, "copy_to_cpu with force transfers");
+
+    clear_buffer_pool();
+    check(stats.frees == 5, "clear_buffer_pool frees the device allocations");
+
+    // transfer accounting: the copies above are out of any stage
+    const TransferStats & other = transfer_accounting().stage("other");
+    check((other.calls == 8) && (other.transfers == 6), "transfers accounted to other");
+    check(other.bytes == 3 * input.size_in_bytes() + 3 * output.size_in_bytes(), "bytes of the transfers");
+
+    input(0, 0) = 0.f;
+    auto upload = account_stage("upload", [&]() {
+        copy_to_gpu(input, device_interface);
+        copy_to_gpu(input, nullptr); // host fallback
+    });
+    upload();
+    upload();
+    const TransferStats & stage = transfer_accounting().stage("upload");
+    check((stage.runs == 2) && (stage.calls == 4) && (stage.transfers == 1), "transfers accounted to the stage");
+    check(stage.bytes == input.size_in_bytes(), "bytes of the stage");
+
+    return failures ? 1 : 0;
+}
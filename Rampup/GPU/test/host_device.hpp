@@ -0,0 +1,96 @@
+#ifndef __HOST_DEVICE__
+#define __HOST_DEVICE__
+
+#include "HalideRuntime.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+    // Device interface whose device memory is a host allocation, with counters of the allocations and of the
+    // transfers, to test the buffer pool and the dirty bits of buffer.hpp without a GPU. It follows the
+    // runtime: copy_to_device allocates when there is no device allocation and copies when the host is
+    // dirty, copy_to_host copies when the device is dirty.
+    struct HostDeviceStats {
+        int mallocs = 0;
+        int frees = 0;
+        int to_device = 0;
+        int to_host = 0;
+    };
+
+    HostDeviceStats host_device_stats;
+
+    int host_device_malloc(void *, halide_buffer_t * buf, const halide_device_interface_t * device_interface) {
+        if(buf->device != 0) {
+            return 0;
+        }
+        void * mem = malloc(buf->size_in_bytes());
+        if(mem == nullptr) {
+            return halide_error_code_out_of_memory;
+        }
+        buf->device = reinterpret_cast<uint64_t>(mem);
+        buf->device_interface = device_interface;
+        host_device_stats.mallocs++;
+        return 0;
+    }
+
+    int host_device_free(void *, halide_buffer_t * buf) {
+        free(reinterpret_cast<void *>(buf->device));
+        buf->device = 0;
+        buf->device_interface = nullptr;
+        buf->set_device_dirty(false);
+        host_device_stats.frees++;
+        return 0;
+    }
+
+    int host_device_sync(void *, halide_buffer_t *) {
+        return 0;
+    }
+
+    void host_device_release(void *, const halide_device_interface_t *) {
+    }
+
+    int host_copy_to_host(void *, halide_buffer_t * buf) {
+        if(buf->device_dirty()) {
+            if(buf->host != nullptr) {
+                memcpy(buf->begin(), reinterpret_cast<void *>(buf->device), buf->size_in_bytes());
+                host_device_stats.to_host++;
+            }
+            buf->set_device_dirty(false);
+        }
+        return 0;
+    }
+
+    int host_copy_to_device(void * user_context, halide_buffer_t * buf, const halide_device_interface_t * device_interface) {
+        const int result = host_device_malloc(user_context, buf, device_interface);
+        if(result != 0) {
+            return result;
+        }
+        if(buf->host_dirty()) {
+            if(buf->host != nullptr) {
+                memcpy(reinterpret_cast<void *>(buf->device), buf->begin(), buf->size_in_bytes());
+                host_device_stats.to_device++;
+            }
+            buf->set_host_dirty(false);
+        }
+        return 0;
+    }
+
+    const halide_device_interface_t * host_device_interface() {
+        static halide_device_interface_t interface = []() {
+            halide_device_interface_t i{};
+            i.device_malloc = host_device_malloc;
+            i.device_free = host_device_free;
+            i.device_sync = host_device_sync;
+            i.device_release = host_device_release;
+            i.copy_to_host = host_copy_to_host;
+            i.copy_to_device = host_copy_to_device;
+            return i;
+        }();
+        return &interface;
+    }
+};
+
+#endif
@@ -28,25 +28,28 @@ int main(int argc, char ** argv) {
     const int width = input.buffer.width();
     const int height = input.buffer.height();
     const int numel = input.buffer.number_of_elements();
-    Buffer<float> lsc_map = load_image(path_lsc_map);
-    Buffer<float> wb_rgb(3);
+    Calibration calibration;
+    if(!load_calibration(path_lsc_map, path_input_metadata, calibration)) {
+        return 1;
+    }
+    Buffer<float> lsc_map = calibration.lsc_map;
+    Buffer<float> wb_rgb = calibration.wb;
     Buffer<float> wb4(4);
-    Buffer<float> ccm(3,3);
-    read_metadata(path_input_metadata, wb_rgb, ccm);
+    Buffer<float> ccm = calibration.ccm;
     transform_wb(input.cfa_pattern, wb_rgb, wb4);
 
     Buffer<uint16_t> output(width, height, 3);
 
     const struct halide_device_interface_t * texture_interface = INTERFACE_TEX;
 
-    run_benchmark(numel, [&]() {
+    run_benchmark(numel, account_stage("isp", [&]() {
         copy_to_gpu(input.buffer, texture_interface);
         copy_to_gpu(lsc_map, texture_interface);
         copy_to_gpu(wb4, texture_interface);
         copy_to_gpu(ccm, texture_interface);
         isp(input.buffer, lsc_map, wb4, ccm, input.black_level, input.white_level, input.cfa_pattern, gamma, sigma_spatial, sigma_range, output);
         copy_to_cpu(output);
-    });
+    }));
 
     save_image(output, path_output);
 
@@ -64,11 +64,14 @@ int test(int argc, char ** argv) {
     const int width = input.buffer.width();
     const int height = input.buffer.height();
     const int numel = input.buffer.number_of_elements();
-    Buffer<float> lsc_map = load_image(path_lsc_map);
-    Buffer<float> wb_rgb(3);
+    Calibration calibration;
+    if(!load_calibration(path_lsc_map, path_input_metadata, calibration)) {
+        return 1;
+    }
+    Buffer<float> lsc_map = calibration.lsc_map;
+    Buffer<float> wb_rgb = calibration.wb;
     Buffer<float> wb4(4);
-    Buffer<float> ccm(3,3);
-    read_metadata(path_input_metadata, wb_rgb, ccm);
+    Buffer<float> ccm = calibration.ccm;
     transform_wb(input.cfa_pattern, wb_rgb, wb4);
 
     Buffer<uint16_t> output(width, height, 3);
@@ -81,13 +84,15 @@ int test(int argc, char ** argv) {
         for(int i=0; i<4; ++i)
             black_level_f32(i) = float(input.black_level(i)) / input.white_level;
 
-        auto copy_gpu = [&]() {
-            copy_to_gpu(input.buffer, texture_interface);
-            copy_to_gpu(lsc_map, texture_interface);
-            copy_to_gpu(wb4, texture_interface);
-            copy_to_gpu(ccm, texture_interface);
-            copy_to_gpu(black_level_f32, texture_interface);
-        };
+        // the benchmark of the transfers forces them, they are skipped when the host is not dirty otherwise
+        auto copy_gpu = account_stage("copy_to_gpu", [&]() {
+            copy_to_gpu(input.buffer, texture_interface, OP == COPY_GPU);
+            // a Func input of bilinear_resize, not stored as a texture
+            copy_to_gpu(lsc_map, device_interface, OP == COPY_GPU);
+            copy_to_gpu(wb4, texture_interface, OP == COPY_GPU);
+            copy_to_gpu(ccm, texture_interface, OP == COPY_GPU);
+            copy_to_gpu(black_level_f32, texture_interface, OP == COPY_GPU);
+        });
         if(OP == COPY_GPU) {
             run_benchmark(numel, copy_gpu);
         } else {
@@ -95,10 +100,10 @@ int test(int argc, char ** argv) {
         }
 
         Buffer<float> im_norm = create_buffer<float>(device_interface, {width, height});
-        auto norm = [&]() {
+        auto norm = account_stage("normalization", [&]() {
             normalization(input.buffer, input.white_level, im_norm);
             im_norm.device_sync();
-        };
+        });
         if(OP == NORM) {
             run_benchmark(numel, norm);
         } else {
@@ -106,10 +111,10 @@ int test(int argc, char ** argv) {
         }
 
         Buffer<float> im_bls = create_buffer<float>(device_interface, {width, height});
-        auto bls = [&]() {
+        auto bls = account_stage("black_level_subtraction", [&]() {
             black_level_subtraction(im_norm, black_level_f32, im_bls);
             im_bls.device_sync();
-        };
+        });
         if(OP == BLS) {
             run_benchmark(numel, bls);
         } else {
@@ -118,10 +123,10 @@ int test(int argc, char ** argv) {
         release_buffer(im_norm);
 
         Buffer<float> lsc_map_bigger = create_buffer<float>(device_interface, {width/2, height/2, 4});
-        auto br = [&]() {
+        auto br = account_stage("bilinear_resize", [&]() {
             bilinear_resize(lsc_map, lsc_map.width(), lsc_map.height(), width/2, height/2, lsc_map_bigger);
             lsc_map_bigger.device_sync();
-        };
+        });
         if(OP == BR) {
             run_benchmark(numel, br);
         } else {
@@ -129,10 +134,10 @@ int test(int argc, char ** argv) {
         }
 
         Buffer<float> im_lsc = create_buffer<float>(device_interface, {width, height});
-        auto lsc = [&]() {
+        auto lsc = account_stage("lens_shading_correction", [&]() {
             lens_shading_correction(im_bls, lsc_map_bigger, im_lsc);
             im_lsc.device_sync();
-        };
+        });
         if(OP == LSC) {
             run_benchmark(numel, lsc);
         } else {
@@ -142,10 +147,10 @@ int test(int argc, char ** argv) {
         release_buffer(lsc_map_bigger);
 
         Buffer<float> im_wb = create_buffer<float>(device_interface, {width, height});
-        auto wb = [&]() {
+        auto wb = account_stage("white_balance", [&]() {
             white_balance(im_lsc, wb4, im_wb);
             im_wb.device_sync();
-        };
+        });
         if(OP == WB) {
             run_benchmark(numel, wb);
         } else {
@@ -154,10 +159,10 @@ int test(int argc, char ** argv) {
         release_buffer(im_lsc);
 
         Buffer<float> im_dms = create_buffer<float>(device_interface, {width, height, 3});
-        auto dms = [&]() {
+        auto dms = account_stage("demosaic", [&]() {
             demosaic(im_wb, width, height, input.cfa_pattern, im_dms);
             im_dms.device_sync();
-        };
+        });
         if(OP == DMS) {
             run_benchmark(numel, dms);
         } else {
@@ -166,10 +171,10 @@ int test(int argc, char ** argv) {
         release_buffer(im_wb);
 
         Buffer<float> im_r2y = create_buffer<float>(device_interface, {width, height, 3});
-        auto r2y = [&]() {
+        auto r2y = account_stage("rgb_to_ycbcr", [&]() {
             rgb_to_ycbcr(im_dms, im_r2y);
             im_r2y.device_sync();
-        };
+        });
         if(OP == R2Y) {
             run_benchmark(numel, r2y);
         } else {
@@ -177,10 +182,10 @@ int test(int argc, char ** argv) {
         }
 
         Buffer<float> im_dns = create_buffer<float>(device_interface, {width, height, 2}, {0, 0, 1});
-        auto bd = [&]() {
+        auto bd = account_stage("bilateral_denoise", [&]() {
             bilateral_denoise(im_r2y, im_dms, width, height, sigma_spatial, sigma_range, im_dns);
             im_dns.device_sync();
-        };
+        });
         if(OP == BD) {
             run_benchmark(numel, bd);
         } else {
@@ -189,10 +194,10 @@ int test(int argc, char ** argv) {
         release_buffer(im_dms);
 
         Buffer<float> im_mix = create_buffer<float>(device_interface, {width, height, 3});
-        auto lmix = [&]() {
+        auto lmix = account_stage("mix", [&]() {
             mix(im_r2y, im_dns, im_mix);
             im_mix.device_sync();
-        };
+        });
         if(OP == MIX) {
             run_benchmark(numel, lmix);
         } else {
@@ -202,10 +207,10 @@ int test(int argc, char ** argv) {
         release_buffer(im_dns);
 
         Buffer<float> im_y2r = create_buffer<float>(device_interface, {width, height, 3});
-        auto y2r = [&]() {
+        auto y2r = account_stage("ycbcr_to_rgb", [&]() {
             ycbcr_to_rgb(im_mix, im_y2r);
             im_y2r.device_sync();
-        };
+        });
         if(OP == Y2R) {
             run_benchmark(numel, y2r);
         } else {
@@ -214,10 +219,10 @@ int test(int argc, char ** argv) {
         release_buffer(im_mix);
 
         Buffer<float> im_cc = create_buffer<float>(device_interface, {width, height, 3});
-        auto cc = [&]() {
+        auto cc = account_stage("color_correction", [&]() {
             color_correction(im_y2r, ccm, im_cc);
             im_cc.device_sync();
-        };
+        });
         if(OP == CC) {
             run_benchmark(numel, cc);
         } else {
@@ -226,10 +231,10 @@ int test(int argc, char ** argv) {
         release_buffer(im_y2r);
 
         Buffer<float> im_tm = create_buffer<float>(device_interface, {width, height, 3});
-        auto rtm = [&]() {
+        auto rtm = account_stage("reinhard_tone_mapping", [&]() {
             reinhard_tone_mapping(im_cc, width, height, im_tm);
             im_tm.device_sync();
-        };
+        });
         if(OP == RTM) {
             run_benchmark(numel, rtm);
         } else {
@@ -238,10 +243,10 @@ int test(int argc, char ** argv) {
         release_buffer(im_cc);
 
         Buffer<float> im_gc = create_buffer<float>(device_interface, {width, height, 3});
-        auto gc = [&]() {
+        auto gc = account_stage("gamma_correction", [&]() {
             gamma_correction(im_tm, gamma, im_gc);
             im_gc.device_sync();
-        };
+        });
         if(OP == GC) {
             run_benchmark(numel, gc);
         } else {
@@ -249,10 +254,10 @@ int test(int argc, char ** argv) {
         }
         release_buffer(im_tm);
 
-        auto dnorm = [&]() {
+        auto dnorm = account_stage("denormalization", [&]() {
             denormalization(im_gc, 65535, output);
             output.device_sync();
-        };
+        });
         if(OP == DNORM) {
             run_benchmark(numel, dnorm);
         } else {
@@ -260,14 +265,17 @@ int test(int argc, char ** argv) {
         }
         release_buffer(im_gc);
 
-        auto copy_cpu = [&]() {
-            copy_to_cpu(output);
-        };
+        auto copy_cpu = account_stage("copy_to_cpu", [&]() {
+            copy_to_cpu(output, OP == COPY_CPU);
+        });
         if(OP == COPY_CPU) {
             run_benchmark(numel, copy_cpu);
         } else {
             copy_cpu();
         }
+
+        printf("buffers: %d allocated, %d recycled\n", buffer_pool().allocated, buffer_pool().recycled);
+        clear_buffer_pool();
     }
 
     save_image(output, path_output);
@@ -3,6 +3,7 @@
 
 #include "halide_base.hpp"
 #include "constants.hpp"
+#include "color_conversion.hpp"
 
 namespace {
     using namespace Halide;
@@ -10,74 +11,188 @@ namespace {
 
     class BilateralDenoise : public Generator<BilateralDenoise>, public HalideBase {
     private:
-        Var x{"x"}, y{"y"}, c{"c"}, i{"i"}, j{"j"};
-        RDom kernel;
+        Var x{"x"}, y{"y"}, c{"c"}, i{"i"}, j{"j"}, z{"z"};
+        RDom kernel, r_splat;
         Func input_bound{"input_bound"}, guide_bound{"guide_bound"};
         Func weights_spatial{"weights_spatial"}, weights_range{"weights_range"};
         Func diff_y{"diff_y"}, norm_y{"norm_y"}, weights_y{"weights_y"}, sum_y{"sum_y"}, output_y{"output_y"};
         Func diff_x{"diff_x"}, norm_x{"norm_x"}, weights_x{"weights_x"}, sum_x{"sum_x"}, output_x{"output_x"};
+        Func guide_gray{"guide_gray"}, grid{"grid"}, blur_z{"blur_z"}, blur_x{"blur_x"}, blur_y{"blur_y"};
+        Func interpolated{"interpolated"};
 
-        Expr gaussian(Expr i, Expr sigma) {
+        static Expr gaussian(Expr i, Expr sigma) {
             return exp(-(i*i)/(2.f*sigma*sigma));
         }
+
+        Expr to_unit(Expr e) {
+            return int_mode ? f32(e) / max16_f32 : e;
+        }
     public:
-        Input<Func> input{"input", Float(32), 3};
-        Input<Func> guide{"guide", Float(32), 3};
+        // size of the tables of the weights: |i| <= max_gaussian_width and norm in (0, 3*max14_u16)
+        static const int max_gaussian_width = 15;
+        static const int weights_range_size = 3*max14_u16 + 1;
+
+        static Expr weight_spatial(Expr i, Expr sigma_spatial) {
+            return gaussian(i, sigma_spatial);
+        }
+        static Expr weight_range(Expr i, Expr sigma_range) {
+            return gaussian(f32(i)/(3.f*max14_f32), sigma_range);
+        }
+
+        // If they are defined before apply(), the weights come from these tables (float, indexed by |i| and
+        // by the norm respectively, e.g. computed once by ISPLuts) instead of being computed on every call.
+        // The norm is a uint16_t, so it is clamped to the weights_range_size entries of the table.
+        Func weights_spatial_input, weights_range_input;
+
+        Input<Func> input{"input"};
+        Input<Func> guide{"guide"};
         Input<int32_t> width{"width"};
         Input<int32_t> height{"height"};
         Input<float> sigma_spatial{"sigma_spatial"};
         Input<float> sigma_range{"sigma_range"};
 
-        Output<Func> output{"output_bd", Float(32), 3};
+        Output<Func> output{"output_bd"};
 
         GeneratorParam<int32_t> channel_min{"channel_min", 1};
         GeneratorParam<int32_t> channel_extent{"channel_extent", 2};
         GeneratorParam<LoopLevel> sum_x_compute_level{"sum_x_compute_level", LoopLevel::inlined()};
         GeneratorParam<LoopLevel> sum_y_compute_level{"sum_y_compute_level", LoopLevel::inlined()};
+        // Bilateral grid instead of the separable filter, its cost does not depend on sigma_spatial
+        GeneratorParam<bool> bilateral_grid{"bilateral_grid", false};
 
         void generate() {
             input_bound = BoundaryConditions::repeat_edge(input, {{0, width}, {0, height}, {0, 3}});
             guide_bound = BoundaryConditions::repeat_edge(guide, {{0, width}, {0, height}, {0, 3}});
 
-            Expr gaussian_width = clamp(i32(3.f*sigma_spatial), 1, 15);
+            Expr gaussian_width = clamp(i32(3.f*sigma_spatial), 1, max_gaussian_width);
             Expr kernel_size = 2*gaussian_width + 1;
             kernel = RDom(-gaussian_width, kernel_size, "kernel");
 
-            weights_spatial(i) = gaussian(i, sigma_spatial);
-            weights_range(i) = gaussian(f32(i)/(3.f*max14_f32), sigma_range);
+            if(bilateral_grid) {
+                generate_grid();
+                return;
+            }
+
+            if(int_mode) {
+                generate_int();
+                return;
+            }
+
+            weights_spatial(i) = weights_spatial_input.defined() ? weights_spatial_input(abs(i)) : weight_spatial(i, sigma_spatial);
+            weights_range(i) = weights_range_input.defined() ? weights_range_input(min(i, weights_range_size - 1)) : weight_range(i, sigma_range);
+
+            diff_y(x, y, i, c, _) = absd(guide_bound(x, y, c, _), guide_bound(x, y + i, c, _));
+            norm_y(x, y, i, _) = u16_sat((diff_y(x, y, i, 0, _) + diff_y(x, y, i, 1, _) + diff_y(x, y, i, 2, _))*max14_f32);
+            weights_y(x, y, i, _) = weights_spatial(i) * weights_range(norm_y(x, y, i, _));
+
+            // sum_y(x, y, c, _) = 0.f; the clamp keeps input_bound and output_y to the filtered channels
+            sum_y(x, y, c, _) += select(c == channel_min-1, weights_y(x, y, kernel, _),
+                                weights_y(x, y, kernel, _) * input_bound(x, y + kernel, clamp(c, channel_min, channel_min-1 + channel_extent), _));
+
+            output_y(x, y, c, _) = sum_y(x, y, c, _)/sum_y(x, y, channel_min-1, _);
+
+            diff_x(x, y, i, c, _) = absd(guide_bound(x, y, c, _), guide_bound(x + i, y, c, _)); //inline?
+            norm_x(x, y, i, _) = u16_sat((diff_x(x, y, i, 0, _) + diff_x(x, y, i, 1, _) + diff_x(x, y, i, 2, _))*max14_f32); //inline?
+            weights_x(x, y, i, _) = weights_spatial(i) * weights_range(norm_x(x, y, i, _)); //compute?
+
+            // sum_x(x, y, c, _) = 0.f;
+            sum_x(x, y, c, _) += select(c == channel_min-1, weights_x(x, y, kernel, _), //compute
+                                weights_x(x, y, kernel, _) * output_y(x + kernel, y, clamp(c, channel_min, channel_min-1 + channel_extent), _));
+
+            output_x(x, y, c, _) = sum_x(x, y, c, _)/sum_x(x, y, channel_min-1, _); //inline
+
+            output(x, y, c, _) = clamp(output_x(x, y, c, _), 0.f, 1.f); //compute_root
+        }
+
+        // Same Funcs with the weights in UQ0.16 and the sums in uint32_t. The norm of the
+        // difference keeps the indexing of weights_range: (d0+d1+d2)/4 ~ (d0+d1+d2)*max14_f32 in float.
+        // The final normalization takes one float division per pixel, as sum*65536 overflows uint32_t.
+        void generate_int() {
+            Expr w_spatial = weights_spatial_input.defined() ? weights_spatial_input(abs(i)) : weight_spatial(i, sigma_spatial);
+            Expr w_range = weights_range_input.defined() ? weights_range_input(min(i, weights_range_size - 1)) : weight_range(i, sigma_range);
+            weights_spatial(i) = u16_sat(w_spatial * max16_f32);
+            weights_range(i) = u16_sat(w_range * max16_f32);
+
+            diff_y(x, y, i, c, _) = absd(guide_bound(x, y, c, _), guide_bound(x, y + i, c, _));
+            norm_y(x, y, i, _) = u16((u32(diff_y(x, y, i, 0, _)) + diff_y(x, y, i, 1, _) + diff_y(x, y, i, 2, _)) >> 2);
+            weights_y(x, y, i, _) = u16((u32(weights_spatial(i)) * weights_range(norm_y(x, y, i, _)) + (1 << 15)) >> 16);
+
+            sum_y(x, y, c, _) += select(c == channel_min-1, u32(weights_y(x, y, kernel, _)),
+                                (u32(weights_y(x, y, kernel, _)) * input_bound(x, y + kernel, clamp(c, channel_min, channel_min-1 + channel_extent), _) + (1 << 15)) >> 16);
+
+            output_y(x, y, c, _) = u16_sat(f32(sum_y(x, y, c, _)) * 65536.f / f32(sum_y(x, y, channel_min-1, _)) + 0.5f);
+
+            diff_x(x, y, i, c, _) = absd(guide_bound(x, y, c, _), guide_bound(x + i, y, c, _));
+            norm_x(x, y, i, _) = u16((u32(diff_x(x, y, i, 0, _)) + diff_x(x, y, i, 1, _) + diff_x(x, y, i, 2, _)) >> 2);
+            weights_x(x, y, i, _) = u16((u32(weights_spatial(i)) * weights_range(norm_x(x, y, i, _)) + (1 << 15)) >> 16);
 
-            diff_y(x, y, i, c) = absd(guide_bound(x, y, c), guide_bound(x, y + i, c));
-            norm_y(x, y, i) = u16_sat((diff_y(x, y, i, 0) + diff_y(x, y, i, 1) + diff_y(x, y, i, 2))*max14_f32);
-            weights_y(x, y, i) = weights_spatial(i) * weights_range(norm_y(x, y, i));
+            sum_x(x, y, c, _) += select(c == channel_min-1, u32(weights_x(x, y, kernel, _)),
+                                (u32(weights_x(x, y, kernel, _)) * output_y(x + kernel, y, clamp(c, channel_min, channel_min-1 + channel_extent), _) + (1 << 15)) >> 16);
 
-            // sum_y(x, y, c) = 0.f;
-            sum_y(x, y, c) += select(c == channel_min-1, weights_y(x, y, kernel),
-                                weights_y(x, y, kernel) * input_bound(x, y + kernel, c));
+            output_x(x, y, c, _) = u16_sat(f32(sum_x(x, y, c, _)) * 65536.f / f32(sum_x(x, y, channel_min-1, _)) + 0.5f);
 
-            output_y(x, y, c) = sum_y(x, y, c)/sum_y(x, y, channel_min-1);
+            output(x, y, c, _) = output_x(x, y, c, _);
+        }
+
+        // Bilateral grid guided by the luma of guide: the input is splatted in cells of s_sigma x s_sigma
+        // pixels and sigma_range of luma, blurred by [1 4 6 4 1] in the 3 dimensions and sliced with a
+        // trilinear interpolation. As in sum_y and sum_x, channel channel_min-1 holds the sum of the weights.
+        // The grid is in float also in int_mode.
+        void generate_grid() {
+            Expr s_sigma = max(1, i32(sigma_spatial));
+
+            guide_gray(x, y, _) = rgb_to_gray(to_unit(guide_bound(x, y, 0, _)), to_unit(guide_bound(x, y, 1, _)), to_unit(guide_bound(x, y, 2, _)));
 
-            diff_x(x, y, i, c) = absd(guide_bound(x, y, c), guide_bound(x + i, y, c)); //inline?
-            norm_x(x, y, i) = u16_sat((diff_x(x, y, i, 0) + diff_x(x, y, i, 1) + diff_x(x, y, i, 2))*max14_f32); //inline?
-            weights_x(x, y, i) = weights_spatial(i) * weights_range(norm_x(x, y, i)); //compute?
+            r_splat = RDom(0, s_sigma, 0, s_sigma, "r_splat");
+            Expr sx = x*s_sigma + r_splat.x - s_sigma/2;
+            Expr sy = y*s_sigma + r_splat.y - s_sigma/2;
+            Expr sz = i32(guide_gray(sx, sy, _) / sigma_range + 0.5f);
+            // grid(x, y, z, c, _) = 0.f;
+            grid(x, y, sz, c, _) += select(c == channel_min-1, 1.f, to_unit(input_bound(sx, sy, c, _)));
 
-            // sum_x(x, y, c) = 0.f;
-            sum_x(x, y, c) += select(c == channel_min-1, weights_x(x, y, kernel), //compute
-                                weights_x(x, y, kernel) * output_y(x + kernel, y, c));
+            blur_z(x, y, z, c, _) = grid(x, y, z - 2, c, _) + 4.f*grid(x, y, z - 1, c, _) + 6.f*grid(x, y, z, c, _)
+                                  + 4.f*grid(x, y, z + 1, c, _) + grid(x, y, z + 2, c, _);
+            blur_x(x, y, z, c, _) = blur_z(x - 2, y, z, c, _) + 4.f*blur_z(x - 1, y, z, c, _) + 6.f*blur_z(x, y, z, c, _)
+                                  + 4.f*blur_z(x + 1, y, z, c, _) + blur_z(x + 2, y, z, c, _);
+            blur_y(x, y, z, c, _) = blur_x(x, y - 2, z, c, _) + 4.f*blur_x(x, y - 1, z, c, _) + 6.f*blur_x(x, y, z, c, _)
+                                  + 4.f*blur_x(x, y + 1, z, c, _) + blur_x(x, y + 2, z, c, _);
 
-            output_x(x, y, c) = sum_x(x, y, c)/sum_x(x, y, channel_min-1); //inline
+            Expr gz = guide_gray(x, y, _) / sigma_range;
+            Expr cz = i32(gz);
+            Expr fz = gz - cz;
+            Expr cx = x / s_sigma;
+            Expr fx = f32(x % s_sigma) / s_sigma;
+            Expr cy = y / s_sigma;
+            Expr fy = f32(y % s_sigma) / s_sigma;
+            interpolated(x, y, c, _) = lerp(
+                lerp(lerp(blur_y(cx, cy,     cz, c, _), blur_y(cx + 1, cy,     cz, c, _), fx),
+                     lerp(blur_y(cx, cy + 1, cz, c, _), blur_y(cx + 1, cy + 1, cz, c, _), fx), fy),
+                lerp(lerp(blur_y(cx, cy,     cz + 1, c, _), blur_y(cx + 1, cy,     cz + 1, c, _), fx),
+                     lerp(blur_y(cx, cy + 1, cz + 1, c, _), blur_y(cx + 1, cy + 1, cz + 1, c, _), fx), fy),
+                fz
+            );
 
-            output(x, y, c) = clamp(output_x(x, y, c), 0.f, 1.f); //compute_root
+            Expr out = interpolated(x, y, c, _) / interpolated(x, y, channel_min-1, _);
+            if(int_mode) {
+                output(x, y, c, _) = u16_sat(out * max16_f32 + 0.5f);
+            } else {
+                output(x, y, c, _) = clamp(out, 0.f, 1.f);
+            }
         }
 
         void schedule() {
             if (auto_schedule) {
-                input.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
-                guide.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
-                sigma_spatial.set_estimate(5.f);
-                sigma_range.set_estimate(0.05f);
-                output.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
+                if(input.dimensions() == 3) {
+                    input.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
+                    guide.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
+                    sigma_spatial.set_estimate(5.f);
+                    sigma_range.set_estimate(0.05f);
+                    output.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
+                }
+            } else if(gpu_schedule(get_target()) && !bilateral_grid) { // schedule_grid is CPU only
+                schedule_gpu();
             } else {
-                const int vector_size = get_target().natural_vector_size<float>();
+                const int vector_size = cpu_vector_size(get_target(), pixel_type());
                 const int parallel_size_1d = 256;
                 const int parallel_size_2d_y =
                     (uint32_t(scheduler-6)<2) ? 2: //scheduler=6,7
@@ -103,16 +218,26 @@ namespace {
                 Var yo{"yo"}, yi{"yi"}, yoo{"yoo"};
                 RVar kernel_o{"kernel_o"}, kernel_i{"kernel_i"};
 
-                weights_spatial.compute_root()
-                    .split(i, xo, xi, parallel_size_1d)
-                    .parallel(xo)
-                    .vectorize(xi, vector_size)
-                ;
-                weights_range.compute_root()
-                    .split(i, xo, xi, parallel_size_1d)
-                    .parallel(xo)
-                    .vectorize(xi, vector_size)
-                ;
+                if(bilateral_grid) {
+                    schedule_grid();
+                    return;
+                }
+
+                // the tables given as inputs are only read, unless they are converted to int_mode
+                if(!weights_spatial_input.defined() || int_mode) {
+                    weights_spatial.compute_root()
+                        .split(i, xo, xi, parallel_size_1d)
+                        .parallel(xo)
+                        .vectorize(xi, vector_size)
+                    ;
+                }
+                if(!weights_range_input.defined() || int_mode) {
+                    weights_range.compute_root()
+                        .split(i, xo, xi, parallel_size_1d)
+                        .parallel(xo)
+                        .vectorize(xi, vector_size)
+                    ;
+                }
                 switch (scheduler)
                 {
                 case 3:
@@ -387,6 +512,280 @@ namespace {
                 }
             }
         }
+
+        // GPU schedules, for a target with a GPU feature: scheduler picks one of them
+        void schedule_gpu() {
+            const int mscheduler = (scheduler==0)?12:scheduler;
+            const int parallel_size_1d = 256;
+            const int num_threads_x = 64;
+            const int num_threads_y = 16;
+            const int num_threads_1d = std::min(num_threads_x*num_threads_y,512);
+            const int vector_size = 4;
+            Var xo{"xo"}, xi{"xi"}, xi2{"xi2"};
+            Var yo{"yo"}, yi{"yi"}, yi2{"yi2"};
+
+            weights_spatial.compute_root()
+                .split(i, xo, xi, parallel_size_1d)
+                .parallel(xo)
+                .vectorize(xi, vector_size)
+            ;
+            weights_range.compute_root()
+                .split(i, xo, xi, parallel_size_1d)
+                .parallel(xo)
+                .vectorize(xi, vector_size)
+            ;
+            switch (mscheduler)
+            {
+            case 2:
+            case 3:
+                output.compute_root()
+                    .bound(c, channel_min, channel_extent)
+                    .split(x, xo, xi, num_threads_1d*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .reorder(xi2, c, xi, xo, y)
+                    .gpu_blocks(xo, y)
+                    .gpu_threads(xi)
+                    .vectorize(xi2)
+                ;
+                output_y.compute_root()
+                    .split(x, xo, xi, num_threads_1d*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .reorder(xi2, c, xi, xo, y)
+                    .gpu_blocks(xo, y)
+                    .gpu_threads(xi)
+                    .vectorize(xi2)
+                ;
+                break;
+
+            case 4:
+            case 5:
+                output.compute_root()
+                    .bound(c, channel_min, channel_extent)
+                    .split(x, xo, xi, num_threads_x*num_threads_y)
+                    .reorder(c, xi, xo, y)
+                    .gpu_blocks(xo, y)
+                    .gpu_threads(xi)
+                    .vectorize(c)
+                ;
+                output_y.compute_root()
+                    .split(x, xo, xi, num_threads_x*num_threads_y)
+                    .reorder(c, xi, xo, y)
+                    .gpu_blocks(xo, y)
+                    .gpu_threads(xi)
+                    .vectorize(c)
+                ;
+                break;
+
+            case 6:
+            case 7:
+                output.compute_root()
+                    .bound(c, channel_min, channel_extent)
+                    .split(x, xo, xi, num_threads_x*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, num_threads_y/((scheduler==6)?2:1))
+                    .reorder(xi2, c, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(xi2)
+                ;
+                output_y.compute_root()
+                    .split(x, xo, xi, num_threads_x*vector_size/((scheduler==6)?2:1))
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, num_threads_y)
+                    .reorder(xi2, c, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(xi2)
+                ;
+                break;
+
+            case 8:
+            case 9:
+                output.compute_root()
+                    .bound(c, channel_min, channel_extent)
+                    .split(x, xo, xi, num_threads_x)
+                    .split(y, yo, yi, num_threads_y*vector_size/((scheduler==8)?2:1))
+                    .split(yi, yi, yi2, vector_size)
+                    .reorder(yi2, c, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(yi2)
+                ;
+                output_y.compute_root()
+                    .split(x, xo, xi, num_threads_x/((scheduler==8)?2:1))
+                    .split(y, yo, yi, num_threads_y*vector_size)
+                    .split(yi, yi, yi2, vector_size)
+                    .reorder(yi2, c, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(yi2)
+                ;
+                break;
+
+            case 10:
+            case 11:
+                output.compute_root()
+                    .bound(c, channel_min, channel_extent)
+                    .split(x, xo, xi, num_threads_x)
+                    .split(y, yo, yi, num_threads_y)
+                    .reorder(c, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(c)
+                ;
+                output_y.compute_root()
+                    .split(x, xo, xi, num_threads_x)
+                    .split(y, yo, yi, num_threads_y)
+                    .reorder(c, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(c)
+                ;
+                break;
+
+            default:
+            case 1:
+            case 12:
+                output.compute_root() //tx*ty*vs*c
+                    .bound(c, channel_min, channel_extent)
+                    .split(x, xo, xi, num_threads_x)
+                    .split(y, yo, yi, num_threads_y*vector_size)
+                    .split(yi, yi, yi2, vector_size)
+                    .reorder(yi2, c, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(yi2)
+                ;
+                output_y.compute_root()
+                    .split(x, xo, xi, num_threads_x/2)
+                    .split(y, yo, yi, num_threads_y*vector_size)
+                    .split(yi, yi, yi2, vector_size)
+                    .reorder(yi2, c, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(yi2)
+                ;
+                // tx*(ty*vs+2*gw+1)*c = tx*(ty*vs+2*15+1)*c = tx*(ty*vs+31)*c ~= 2*tx*ty*vs*c = 2*tx*ty*4*2 = 16*tx*ty = 16K = 64KB
+                input_bound.compute_at(output_y, xo)
+                    .store_in(MemoryType::GPUShared)
+                    .split(_0, xo, xi, num_threads_x/2)
+                    .split(_1, yo, yi, num_threads_y*vector_size)
+                    .split(yi, yi, yi2, vector_size)
+                    .reorder(yi2, _2, xi, yi, xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(yi2)
+                ;
+                break;
+
+            case 13:
+                output.compute_root() //tx*ty*vs*c
+                    .bound(c, channel_min, channel_extent)
+                    .split(x, xo, xi, num_threads_x)
+                    .split(y, yo, yi, num_threads_y*vector_size)
+                    .split(yi, yi, yi2, vector_size)
+                    .reorder(yi2, c, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(yi2)
+                ;
+                output_y.compute_root()
+                    .split(x, xo, xi, num_threads_x)
+                    .split(y, yo, yi, num_threads_y*vector_size/2)
+                    .split(yi, yi, yi2, vector_size)
+                    .reorder(yi2, c, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(yi2)
+                ;
+                input_bound.compute_at(output_y, xo)
+                    .store_in(MemoryType::GPUShared)
+                    .split(_0, xo, xi, num_threads_x)
+                    .split(_1, yo, yi, num_threads_y*vector_size/2)
+                    .split(yi, yi, yi2, vector_size)
+                    .reorder(yi2, _2, xi, yi, xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(yi2)
+                ;
+                break;
+            }
+            sum_x.compute_at(output, xi)
+                .vectorize(x)
+                .vectorize(y)
+            ;
+            sum_x.update()
+                .reorder(x, y, c, kernel)
+                .vectorize(x)
+                .vectorize(y)
+                .unroll(c)
+            ;
+            sum_y.compute_at(output_y, xi)
+                .vectorize(x)
+                .vectorize(y)
+            ;
+            sum_y.update()
+                .reorder(x, y, c, kernel)
+                .vectorize(x)
+                .vectorize(y)
+                .unroll(c)
+            ;
+            if((mscheduler < 12) && ((mscheduler%2) == 0)) {
+                sum_x.store_in(MemoryType::GPUShared);
+                sum_y.store_in(MemoryType::GPUShared);
+            } else {
+                sum_x.store_in(MemoryType::Register);
+                sum_y.store_in(MemoryType::Register);
+            }
+        }
+
+        void schedule_grid() {
+            const int vector_size = cpu_vector_size(get_target(), Float(32));
+            Var xo{"xo"}, xi{"xi"};
+
+            // par y
+            //  compute grid at the row y of the grid
+            //  compute blur_z
+            // par z: compute blur_x
+            // par z: compute blur_y
+            // par y: compute output
+            blur_z.compute_root()
+                .bound(c, channel_min-1, channel_extent+1)
+                .reorder(c, z, x, y)
+                .parallel(y)
+                .vectorize(x, vector_size)
+                .unroll(c)
+            ;
+            grid.compute_at(blur_z, y);
+            grid.update()
+                .reorder(c, r_splat.x, r_splat.y, x, y)
+                .unroll(c)
+            ;
+            blur_x.compute_root()
+                .reorder(c, x, y, z)
+                .parallel(z)
+                .vectorize(x, vector_size)
+                .unroll(c)
+            ;
+            blur_y.compute_root()
+                .reorder(c, x, y, z)
+                .parallel(z)
+                .vectorize(x, vector_size)
+                .unroll(c)
+            ;
+            if(out_define_schedule) {
+                output
+                    .bound(c, channel_min, channel_extent)
+                    .split(x, xo, xi, get_target().natural_vector_size(pixel_type()))
+                    .reorder(xi, c, xo, y)
+                    .unroll(c)
+                    .vectorize(xi)
+                ;
+                if(out_define_compute) {
+                    output.compute_root()
+                        .parallel(y)
+                    ;
+                }
+            }
+        }
     };
 };
 
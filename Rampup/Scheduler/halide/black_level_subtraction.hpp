@@ -10,21 +10,30 @@ namespace {
     private:
         Var x{"x"}, y{"y"};
     public:
-        Input<Func> input{"input", Float(32), 2};
-        Input<Func> black_level{"black_level", Float(32), 1};
-        Output<Func> output{"output_bls", Float(32), 2};
+        Input<Func> input{"input"};
+        Input<Func> black_level{"black_level", 1};
+        Output<Func> output{"output_bls"};
 
         void generate() {
-            output(x, y) = max(0.0f, input(x, y) - black_level((x % 2) + (y % 2)*2));
+            if(int_mode) {
+                // UQ0.16 - UQ0.16, saturated at 0
+                output(x, y, _) = input(x, y, _) - min(input(x, y, _), black_level((x % 2) + (y % 2)*2));
+            } else {
+                output(x, y, _) = max(0.0f, input(x, y, _) - black_level((x % 2) + (y % 2)*2));
+            }
         }
 
         void schedule() {
             if(auto_schedule) {
-                input.set_estimates({{0,4000},{0,3000}});
-                black_level.set_estimates({{0,4}});
-                output.set_estimates({{0,4000},{0,3000}});
+                if(input.dimensions() == 2) {
+                    input.set_estimates({{0,4000},{0,3000}});
+                    black_level.set_estimates({{0,4}});
+                    output.set_estimates({{0,4000},{0,3000}});
+                }
+            } else if(gpu_schedule(get_target())) {
+                schedule_gpu();
             } else {
-                const int vector_size = get_target().natural_vector_size(Float(32));
+                const int vector_size = cpu_vector_size(get_target(), pixel_type());
                 Var xo("xo"), xi("xi"), yo("yo"), yi("yi");
 
                 switch (scheduler)
@@ -67,6 +76,156 @@ namespace {
                 }
             }
         }
+
+        // GPU schedules, for a target with a GPU feature: scheduler picks one of them
+        void schedule_gpu() {
+            const int num_threads = 32;
+            const int vector_size = 4;
+            Var xo{"xo"}, xi{"xi"}, xi2{"xi2"}, xi3{"xi3"};
+            Var yo{"yo"}, yi{"yi"}, yi2{"yi2"}, yi3{"yi3"};
+            if(get_target().has_feature(Target::OpenCL)) {
+                black_level.in().compute_root().store_in(MemoryType::GPUTexture);
+            }
+            switch (scheduler)
+            {
+            case 2:
+                output.compute_root()
+                    .split(x, xo, xi, std::min(num_threads*num_threads,512)*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    //.reorder(xi2, xi, xo, y)
+                    .gpu_blocks(xo, y)
+                    .gpu_threads(xi)
+                    .vectorize(xi2)
+                ;
+                break;
+
+            case 3:
+                output.compute_root()
+                    .align_bounds(x, 2, 0)
+                    .align_bounds(y, 2, 0)
+                    .split(x, xo, xi, std::min(num_threads*num_threads,256)*vector_size*2)
+                    .split(xi, xi, xi2, vector_size*2)
+                    .split(xi2, xi2, xi3, 2)
+                    .split(y, yo, yi, 2)
+                    .reorder(xi3, yi, xi2, xi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi)
+                    .vectorize(xi2)
+                    .unroll(yi)
+                    .unroll(xi3)
+                ;
+                break;
+
+            case 4:
+                output.compute_root()
+                    .align_bounds(x, 2, 0)
+                    .align_bounds(y, 2, 0)
+                    .split(x, xo, xi, std::min(num_threads*num_threads,512)*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, 2)
+                    .reorder(yi, xi2, xi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi)
+                    .vectorize(xi2)
+                    .unroll(yi)
+                ;
+                break;
+
+            default:
+            case 1:
+            case 5:
+                output.compute_root()
+                    .split(x, xo, xi, num_threads*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, num_threads)
+                    .reorder(xi2, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(xi2)
+                ;
+                break;
+
+            case 6:
+                output.compute_root()
+                    .align_bounds(x, 2, 0)
+                    .align_bounds(y, 2, 0)
+                    .split(x, xo, xi, num_threads*vector_size*2)
+                    .split(xi, xi, xi2, vector_size*2)
+                    .split(xi2, xi2, xi3, 2)
+                    .split(y, yo, yi, num_threads*2)
+                    .split(yi, yi, yi2, 2)
+                    .reorder(xi3, yi2, xi2, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(xi2)
+                    .unroll(yi2)
+                    .unroll(xi3)
+                ;
+                break;
+
+            case 7:
+                output.compute_root()
+                    .align_bounds(x, 2, 0)
+                    .align_bounds(y, 2, 0)
+                    .split(x, xo, xi, num_threads*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, num_threads*2)
+                    .split(yi, yi, yi2, 2)
+                    .reorder(yi2, xi2, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(xi2)
+                    .unroll(yi2)
+                ;
+                break;
+
+            case 8:
+                output.compute_root()
+                    .split(x, xo, xi, num_threads)
+                    .split(y, yo, yi, num_threads*vector_size)
+                    .split(yi, yi, yi2, vector_size)
+                    .reorder(yi2, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(yi2)
+                ;
+                break;
+
+            case 9:
+                output.compute_root()
+                    .align_bounds(x, 2, 0)
+                    .align_bounds(y, 2, 0)
+                    .split(x, xo, xi, num_threads*2)
+                    .split(xi, xi, xi2, 2)
+                    .split(y, yo, yi, num_threads*vector_size*2)
+                    .split(yi, yi, yi2, vector_size*2)
+                    .split(yi2, yi2, yi3, 2)
+                    .reorder(xi2, yi3, yi2, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(yi2)
+                    .unroll(yi3)
+                    .unroll(xi2)
+                ;
+                break;
+
+            case 10:
+                output.compute_root()
+                    .align_bounds(x, 2, 0)
+                    .align_bounds(y, 2, 0)
+                    .split(x, xo, xi, num_threads)
+                    .split(y, yo, yi, num_threads*vector_size*2)
+                    .split(yi, yi, yi2, vector_size*2)
+                    .split(yi2, yi2, yi3, 2)
+                    .reorder(yi3, yi2, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(yi2)
+                    .unroll(yi3)
+                ;
+                break;
+            }
+        }
     };
 
 };
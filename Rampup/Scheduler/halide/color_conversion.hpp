@@ -5,6 +5,7 @@
 
 namespace {
     using namespace Halide;
+    using namespace Halide::ConciseCasts;
 
     Expr rgb_to_gray(Expr r, Expr g, Expr b) {
         return clamp(0.299f*r + 0.587f*g + 0.114f*b, 0.f, 1.f);
@@ -26,6 +27,27 @@ namespace {
         return clamp(y + 1.772f * (cb-0.5f), 0.f, 1.f);
     }
 
+    // int_mode: inputs and outputs in UQ0.16, coefficients in Q15 (rgb -> ycbcr) and Q14 (ycbcr -> rgb)
+    Expr rgb_to_gray_u16(Expr r, Expr g, Expr b) {
+        return u16_sat((u32(r)*9798 + u32(g)*19235 + u32(b)*3735 + (1 << 14)) >> 15);
+    }
+    Expr rgb_to_cb_u16(Expr r, Expr g, Expr b) {
+        return u16_sat(32768 + ((-i32(r)*5529 - i32(g)*10855 + i32(b)*16384 + (1 << 14)) >> 15));
+    }
+    Expr rgb_to_cr_u16(Expr r, Expr g, Expr b) {
+        return u16_sat(32768 + ((i32(r)*16384 - i32(g)*13720 - i32(b)*2664 + (1 << 14)) >> 15));
+    }
+
+    Expr ycbcr_to_r_u16(Expr y, Expr cb, Expr cr) {
+        return u16_sat(i32(y) + ((22970*(i32(cr) - 32768) + (1 << 13)) >> 14));
+    }
+    Expr ycbcr_to_g_u16(Expr y, Expr cb, Expr cr) {
+        return u16_sat(i32(y) - ((5638*(i32(cb) - 32768) + 11700*(i32(cr) - 32768) + (1 << 13)) >> 14));
+    }
+    Expr ycbcr_to_b_u16(Expr y, Expr cb, Expr cr) {
+        return u16_sat(i32(y) + ((29032*(i32(cb) - 32768) + (1 << 13)) >> 14));
+    }
+
 };
 
 #endif
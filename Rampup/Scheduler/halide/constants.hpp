@@ -9,6 +9,13 @@ namespace {
 
     const uint16_t max16_u16 = (1 << 16) - 1;
     const float max16_f32 = max16_u16;
+
+    // int_mode
+    // pixels: UQ0.16 in uint16_t, 65535 = 1.f
+    // gains (white balance, lens shading, tone mapping): UQ4.12 in uint16_t, 4096 = 1.f
+    // color correction matrix: SQ3.12 in int16_t, 4096 = 1.f
+    const int q_gain = 12;
+    const float one_gain_f32 = 1 << q_gain;
 };
 
 #endif
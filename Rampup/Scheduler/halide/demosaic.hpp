@@ -6,6 +6,11 @@
 
 namespace {
     using namespace Halide;
+    using namespace Halide::ConciseCasts;
+
+    const std::map<std::string, CFA> cfa_names = {
+        {"rggb", RGGB}, {"grbg", GRBG}, {"bggr", BGGR}, {"gbrg", GBRG}, {"none", NONE}
+    };
 
     class Demosaic : public Generator<Demosaic>, public HalideBase {
     private:
@@ -14,49 +19,56 @@ namespace {
         Func interpolation_y{"interpolation_y"}, interpolation_x{"interpolation_x"};
         RDom r_max_gray;
     public:
-        Input<Func> input{"input", Float(32), 2};
+        // CFA pattern of the input baked in at generation time, cfa_pattern is then ignored.
+        // none: selected at run time by cfa_pattern
+        GeneratorParam<CFA> cfa{"cfa", NONE, cfa_names};
+
+        Input<Func> input{"input"};
         Input<int> width{"width"};
         Input<int> height{"height"};
         Input<uint8_t> cfa_pattern{"cfa_pattern"};
-        Output<Func> output{"output_demosaic", Float(32), 3};
+        Output<Func> output{"output_demosaic"};
 
         void generate() {
             if(scheduler < 10) {
-                deinterld(x, y, c) = select(
-                    cfa_pattern == RGGB, deinterleave_rggb(input)(x, y, c),
-                    cfa_pattern == GRBG, deinterleave_grbg(input)(x, y, c),
-                    cfa_pattern == BGGR, deinterleave_bggr(input)(x, y, c),
-                    cfa_pattern == GBRG, deinterleave_gbrg(input)(x, y, c),
-                                        0.0f
-                );
+                deinterld(x, y, c, _) = deinterleave(input)(x, y, c, _);
                 deinterld_bound = BoundaryConditions::mirror_interior(deinterld, {{0, width}, {0, height}});
             } else {
                 input_bound = BoundaryConditions::mirror_interior(input, {{0, width}, {0, height}});
-                deinterld_bound(x, y, c) = select(
-                    cfa_pattern == RGGB, deinterleave_rggb(input_bound)(x, y, c),
-                    cfa_pattern == GRBG, deinterleave_grbg(input_bound)(x, y, c),
-                    cfa_pattern == BGGR, deinterleave_bggr(input_bound)(x, y, c),
-                    cfa_pattern == GBRG, deinterleave_gbrg(input_bound)(x, y, c),
-                                        0.0f
-                );
+                deinterld_bound(x, y, c, _) = deinterleave(input_bound)(x, y, c, _);
             }
 
-            interpolation_y(x, y, c) = 0.5f*deinterld_bound(x, y - 1, c) + deinterld_bound(x, y, c) + 0.5f*deinterld_bound(x, y + 1, c);
-            interpolation_x(x, y, c) = 0.5f*interpolation_y(x - 1, y, c) + interpolation_y(x, y, c) + 0.5f*interpolation_y(x + 1, y, c);
+            if(int_mode) {
+                // In each deinterleaved channel either the pixel or its two vertical neighbours are 0,
+                // so interpolation_y fits in UQ0.16. interpolation_x = 2*(0.5*left + center + 0.5*right)
+                // can reach 4*65535 in the green channel and is kept in uint32_t.
+                interpolation_y(x, y, c, _) = u16((u32(deinterld_bound(x, y - 1, c, _)) + deinterld_bound(x, y + 1, c, _) + 1) / 2) + deinterld_bound(x, y, c, _);
+                interpolation_x(x, y, c, _) = u32(interpolation_y(x - 1, y, c, _)) + 2*u32(interpolation_y(x, y, c, _)) + interpolation_y(x + 1, y, c, _);
 
-            Expr interpolation = interpolation_x(x, y, c);
-            Expr out = select(c == 1, 0.5f*interpolation, interpolation);
-            output(x, y, c) = clamp(out, 0.f, 1.f);
+                Expr interpolation = interpolation_x(x, y, c, _);
+                output(x, y, c, _) = u16_sat(select(c == 1, (interpolation + 2) / 4, (interpolation + 1) / 2));
+            } else {
+                interpolation_y(x, y, c, _) = 0.5f*deinterld_bound(x, y - 1, c, _) + deinterld_bound(x, y, c, _) + 0.5f*deinterld_bound(x, y + 1, c, _);
+                interpolation_x(x, y, c, _) = 0.5f*interpolation_y(x - 1, y, c, _) + interpolation_y(x, y, c, _) + 0.5f*interpolation_y(x + 1, y, c, _);
+
+                Expr interpolation = interpolation_x(x, y, c, _);
+                Expr out = select(c == 1, 0.5f*interpolation, interpolation);
+                output(x, y, c, _) = clamp(out, 0.f, 1.f);
+            }
         }
 
         void schedule() {
             if(auto_schedule) {
-                input.set_estimates({{0,4000},{0,3000}});
-                width.set_estimate(4000);
-                height.set_estimate(3000);
-                output.set_estimates({{0,4000},{0,3000},{0,3}});
+                if(input.dimensions() == 2) {
+                    input.set_estimates({{0,4000},{0,3000}});
+                    width.set_estimate(4000);
+                    height.set_estimate(3000);
+                    output.set_estimates({{0,4000},{0,3000},{0,3}});
+                }
+            } else if(gpu_schedule(get_target())) {
+                schedule_gpu();
             } else {
-                const int vector_size = get_target().natural_vector_size<float>();
+                const int vector_size = cpu_vector_size(get_target(), pixel_type());
                 const int parallel_size =  (
                     (uint32_t(scheduler-7)<4)?4: //scheduler=7-10
                                               8  //scheduler=11-18,default
@@ -93,7 +105,7 @@ namespace {
                         .vectorize(xio)
                         .reorder(xii, xio, c, xo, yi, yo)
                     ;
-                    if(scheduler == 4) {
+                    if((scheduler == 4) && (cfa == NONE)) {
                         output.specialize(cfa_pattern == RGGB);
                         output.specialize(cfa_pattern == GRBG);
                         output.specialize(cfa_pattern == GBRG);
@@ -123,7 +135,7 @@ namespace {
                         .vectorize(xio)
                         .reorder(xii, xio, c, xo, y)
                     ;
-                    if(scheduler == 6) {
+                    if((scheduler == 6) && (cfa == NONE)) {
                         interpolation_y.specialize(cfa_pattern == RGGB);
                         interpolation_y.specialize(cfa_pattern == GRBG);
                         interpolation_y.specialize(cfa_pattern == GBRG);
@@ -161,7 +173,7 @@ namespace {
                         .vectorize(xio)
                         .reorder(xii, xio, c, xo, yi, yo)
                     ;
-                    if((scheduler % 2) == 0) { // scheduler == 8,10
+                    if(((scheduler % 2) == 0) && (cfa == NONE)) { // scheduler == 8,10
                         deinterld_bound.specialize(cfa_pattern == RGGB);
                         deinterld_bound.specialize(cfa_pattern == GRBG);
                         deinterld_bound.specialize(cfa_pattern == GBRG);
@@ -205,7 +217,7 @@ namespace {
                         .vectorize(xio)
                         .reorder(xii, xio, c, xo, y)
                     ;
-                    if((scheduler % 2) == 0) { // scheduler == 12,14,16,18
+                    if(((scheduler % 2) == 0) && (cfa == NONE)) { // scheduler == 12,14,16,18
                         deinterld_bound.specialize(cfa_pattern == RGGB);
                         deinterld_bound.specialize(cfa_pattern == GRBG);
                         deinterld_bound.specialize(cfa_pattern == GBRG);
@@ -242,58 +254,212 @@ namespace {
                         .vectorize(xio)
                         .reorder(xii, xio, c, xo, y)
                     ;
+                    if(cfa == NONE) {
+                        interpolation_y.specialize(cfa_pattern == RGGB);
+                        interpolation_y.specialize(cfa_pattern == GRBG);
+                        interpolation_y.specialize(cfa_pattern == GBRG);
+                        interpolation_y.specialize(cfa_pattern == BGGR);
+                    }
+                    break;
+                }
+            }
+        }
+
+        // GPU schedules, for a target with a GPU feature: scheduler picks one of them
+        void schedule_gpu() {
+            const int num_threads = 32 * size_factor;
+            const int vector_size = 4;
+            Var xo{"xo"}, xi{"xi"}, xi2{"xi2"}, xi3{"xi3"};
+            Var yo{"yo"}, yi{"yi"}, yi2{"yi2"}, yi3{"yi3"};
+            switch (scheduler)
+            {
+            default:
+            case 1:
+            case 2:
+                output.compute_root()
+                    .align_bounds(x, 2, 0)
+                    .align_bounds(y, 2, 0)
+                    .bound(c, 0, 3)
+                    .split(x, xo, xi, num_threads*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, num_threads)
+                    .reorder(xi2, c, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(xi2)
+                    .unroll(c)
+                ;
+                break;
+
+            case 5: // compute interpolation_y at GPU blocks
+            case 6:
+                interpolation_y.compute_at(output, xo).store_in(MemoryType::GPUShared)
+                    .split(x, xo, xi, num_threads*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, num_threads*2)
+                    .split(yi, yi, yi2, 2)
+                    .reorder(xi2, yi2, c, xi, yi, xo, yo)
+                    .unroll(xo)
+                    .unroll(yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(xi2)
+                    .unroll(yi2)
+                    .unroll(c)
+                ;
+                if((scheduler == 6) && (cfa == NONE)) {
                     interpolation_y.specialize(cfa_pattern == RGGB);
                     interpolation_y.specialize(cfa_pattern == GRBG);
                     interpolation_y.specialize(cfa_pattern == GBRG);
                     interpolation_y.specialize(cfa_pattern == BGGR);
-                    break;
                 }
+                goto scheduler_3_4;
+
+            case 7: // compute interpolation_y at GPU threads
+            case 8:
+                interpolation_y.compute_at(output, xi).store_in(MemoryType::Register)
+                    .split(x, xi, xi2, vector_size)
+                    .split(y, yi, yi2, 2)
+                    .reorder(xi2, yi2, c, xi, yi)
+                    .vectorize(xi2)
+                    .unroll(yi2)
+                    .unroll(c)
+                ;
+                if((scheduler == 8) && (cfa == NONE)) {
+                    interpolation_y.specialize(cfa_pattern == RGGB);
+                    interpolation_y.specialize(cfa_pattern == GRBG);
+                    interpolation_y.specialize(cfa_pattern == GBRG);
+                    interpolation_y.specialize(cfa_pattern == BGGR);
+                }
+
+            case 3:
+            case 4:
+            scheduler_3_4:
+                output.compute_root()
+                    .align_bounds(x, 2, 0)
+                    .align_bounds(y, 2, 0)
+                    .bound(c, 0, 3)
+                    .split(x, xo, xi, num_threads*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, num_threads*2)
+                    .split(yi, yi, yi2, 2)
+                    .reorder(xi2, yi2, c, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(xi2)
+                    .unroll(yi2)
+                    .unroll(c)
+                ;
+                if((scheduler == 4) && (cfa == NONE)) {
+                    output.specialize(cfa_pattern == RGGB);
+                    output.specialize(cfa_pattern == GRBG);
+                    output.specialize(cfa_pattern == GBRG);
+                    output.specialize(cfa_pattern == BGGR);
+                }
+                break;
+
+            case 9:
+            case 10:
+                output.compute_root()
+                    .align_bounds(x, 2, 0)
+                    .align_bounds(y, 2, 0)
+                    .bound(c, 0, 3)
+                    .split(x, xo, xi, num_threads*vector_size - 2) // reduce 2 from dimension x
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, num_threads/2)
+                    .split(yi, yi, yi2, 2)
+                    .reorder(xi2, yi2, c, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(xi2)
+                    .unroll(yi2)
+                    .unroll(c)
+                ;
+                interpolation_y.compute_at(output, xo).store_in(MemoryType::GPUShared)
+                    .split(x, xo, xi, num_threads*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, num_threads/2)
+                    .split(yi, yi, yi2, 2)
+                    .reorder(xi2, yi2, c, xi, yi, xo, yo)
+                    .unroll(xo)
+                    .unroll(yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(xi2)
+                    .unroll(yi2)
+                    .unroll(c)
+                ;
+                if((scheduler == 10) && (cfa == NONE)) {
+                    interpolation_y.specialize(cfa_pattern == RGGB);
+                    interpolation_y.specialize(cfa_pattern == GRBG);
+                    interpolation_y.specialize(cfa_pattern == GBRG);
+                    interpolation_y.specialize(cfa_pattern == BGGR);
+                }
+                break;
             }
         }
 
     private:
+        // the deinterleaver of cfa, or a select on cfa_pattern between the four of them when cfa is none
+        Func deinterleave(Func input) {
+            switch (cfa.value())
+            {
+            case RGGB: return deinterleave_rggb(input);
+            case GRBG: return deinterleave_grbg(input);
+            case BGGR: return deinterleave_bggr(input);
+            case GBRG: return deinterleave_gbrg(input);
+            default: break;
+            }
+            Func output{"deinterleave"};
+            output(x, y, c, _) = select(
+                cfa_pattern == RGGB, deinterleave_rggb(input)(x, y, c, _),
+                cfa_pattern == GRBG, deinterleave_grbg(input)(x, y, c, _),
+                cfa_pattern == BGGR, deinterleave_bggr(input)(x, y, c, _),
+                cfa_pattern == GBRG, deinterleave_gbrg(input)(x, y, c, _),
+                                    cast(pixel_type(), 0)
+            );
+            return output;
+        }
         Func deinterleave_rggb(Func input) {
             Func output{"deinterleave_rggb"};
 
-            Expr r = (((x % 2) == 0) && ((y % 2) == 0))*input(x, y);
-            Expr g = (((x % 2) == 1) && ((y % 2) == 0))*input(x, y) +
-                     (((x % 2) == 0) && ((y % 2) == 1))*input(x, y);
-            Expr b = (((x % 2) == 1) && ((y % 2) == 1))*input(x, y);
+            Expr r = (((x % 2) == 0) && ((y % 2) == 0))*input(x, y, _);
+            Expr g = (((x % 2) == 1) && ((y % 2) == 0))*input(x, y, _) +
+                     (((x % 2) == 0) && ((y % 2) == 1))*input(x, y, _);
+            Expr b = (((x % 2) == 1) && ((y % 2) == 1))*input(x, y, _);
 
-            output(x, y, c) = mux(c, {r, g, b});
+            output(x, y, c, _) = mux(c, {r, g, b});
             return output;
         }
         Func deinterleave_grbg(Func input) {
             Func output{"deinterleave_grbg"};
 
-            Expr r = (((x % 2) == 1) && ((y % 2) == 0))*input(x, y);
-            Expr g = (((x % 2) == 0) && ((y % 2) == 0))*input(x, y) +
-                     (((x % 2) == 1) && ((y % 2) == 1))*input(x, y);
-            Expr b = (((x % 2) == 0) && ((y % 2) == 1))*input(x, y);
+            Expr r = (((x % 2) == 1) && ((y % 2) == 0))*input(x, y, _);
+            Expr g = (((x % 2) == 0) && ((y % 2) == 0))*input(x, y, _) +
+                     (((x % 2) == 1) && ((y % 2) == 1))*input(x, y, _);
+            Expr b = (((x % 2) == 0) && ((y % 2) == 1))*input(x, y, _);
 
-            output(x, y, c) = mux(c, {r, g, b});
+            output(x, y, c, _) = mux(c, {r, g, b});
             return output;
         }
         Func deinterleave_bggr(Func input) {
             Func output{"deinterleave_bggr"};
 
-            Expr r = (((x % 2) == 1) && ((y % 2) == 1))*input(x, y);
-            Expr g = (((x % 2) == 1) && ((y % 2) == 0))*input(x, y) +
-                     (((x % 2) == 0) && ((y % 2) == 1))*input(x, y);
-            Expr b = (((x % 2) == 0) && ((y % 2) == 0))*input(x, y);
+            Expr r = (((x % 2) == 1) && ((y % 2) == 1))*input(x, y, _);
+            Expr g = (((x % 2) == 1) && ((y % 2) == 0))*input(x, y, _) +
+                     (((x % 2) == 0) && ((y % 2) == 1))*input(x, y, _);
+            Expr b = (((x % 2) == 0) && ((y % 2) == 0))*input(x, y, _);
 
-            output(x, y, c) = mux(c, {r, g, b});
+            output(x, y, c, _) = mux(c, {r, g, b});
             return output;
         }
         Func deinterleave_gbrg(Func input) {
             Func output{"deinterleave_gbrg"};
 
-            Expr r = (((x % 2) == 0) && ((y % 2) == 1))*input(x, y);
-            Expr g = (((x % 2) == 0) && ((y % 2) == 0))*input(x, y) +
-                     (((x % 2) == 1) && ((y % 2) == 1))*input(x, y);
-            Expr b = (((x % 2) == 1) && ((y % 2) == 0))*input(x, y);
+            Expr r = (((x % 2) == 0) && ((y % 2) == 1))*input(x, y, _);
+            Expr g = (((x % 2) == 0) && ((y % 2) == 0))*input(x, y, _) +
+                     (((x % 2) == 1) && ((y % 2) == 1))*input(x, y, _);
+            Expr b = (((x % 2) == 1) && ((y % 2) == 0))*input(x, y, _);
 
-            output(x, y, c) = mux(c, {r, g, b});
+            output(x, y, c, _) = mux(c, {r, g, b});
             return output;
         }
     };
@@ -2,6 +2,7 @@
 #define __DENORMALIZATION__
 
 #include "halide_base.hpp"
+#include "constants.hpp"
 
 namespace {
     using namespace Halide;
@@ -16,7 +17,12 @@ namespace {
         Output<Buffer<uint16_t>> output{"output_denorm"};
 
         void generate() {
-            output(x, _) = u16_sat(f32(input(x, _)) * white_level);
+            if(int_mode) {
+                // UQ0.16 -> (0, white_level), rounded
+                output(x, _) = u16((u32(input(x, _)) * white_level + (max16_u16 >> 1)) / max16_u16);
+            } else {
+                output(x, _) = u16_sat(f32(input(x, _)) * white_level);
+            }
         }
 
         void schedule() {
@@ -26,9 +32,11 @@ namespace {
                     white_level.set_estimate(255);
                     output.set_estimates({{0,4000},{0,3000},{0,3}});
                 }
+            } else if(gpu_schedule(get_target())) {
+                schedule_gpu();
             } else {
                 if(output.dimensions() == 3) {
-                    const int vector_size = get_target().natural_vector_size<float>();
+                    const int vector_size = cpu_vector_size(get_target(), pixel_type());
                     Var yc{"yc"};
                     Var y = output.args()[1];
                     Var c = output.args()[2];
@@ -46,6 +54,70 @@ namespace {
                 }
             }
         }
+
+        // GPU schedules, for a target with a GPU feature: scheduler picks one of them
+        void schedule_gpu() {
+            if(output.dimensions() == 3) {
+                const int num_threads_x = 128;
+                const int num_threads_y = 8;
+                const int vector_size = 4;
+                Var xo{"xo"}, xi{"xi"}, xi2{"xi2"}, xi3{"xi3"};
+                Var yo{"yo"}, yi{"yi"}, yi2{"yi2"}, yi3{"yi3"};
+                Var y = output.args()[1];
+                Var c = output.args()[2];
+                switch (scheduler)
+                {
+                default:
+                case 1:
+                case 2:
+                    output.compute_root()
+                        .split(x, xo, xi, std::min(num_threads_x*num_threads_y,512)*vector_size)
+                        .split(xi, xi, xi2, vector_size)
+                        //.reorder(xi2, xi, xo, y, c)
+                        .gpu_blocks(xo, y, c)
+                        .gpu_threads(xi)
+                        .vectorize(xi2)
+                    ;
+                    break;
+
+                case 3:
+                    output.compute_root()
+                        .split(x, xo, xi, num_threads_x*vector_size)
+                        .split(xi, xi, xi2, vector_size)
+                        .split(y, yo, yi, num_threads_y)
+                        .reorder(xi2, xi, yi, xo, yo, c)
+                        .gpu_blocks(xo, yo, c)
+                        .gpu_threads(xi, yi)
+                        .vectorize(xi2)
+                    ;
+                    break;
+
+                case 4:
+                    output.compute_root()
+                        .split(x, xo, xi, num_threads_x)
+                        .split(y, yo, yi, num_threads_y*vector_size)
+                        .split(yi, yi, yi2, vector_size)
+                        .reorder(yi2, xi, yi, xo, yo, c)
+                        .gpu_blocks(xo, yo, c)
+                        .gpu_threads(xi, yi)
+                        .vectorize(yi2)
+                    ;
+                    break;
+
+                case 5:
+                    output.compute_root()
+                        .split(x, xo, xi, num_threads_x)
+                        .split(y, yo, yi, num_threads_y)
+                        .reorder(c, xi, yi, xo, yo)
+                        .gpu_blocks(xo, yo)
+                        .gpu_threads(xi, yi)
+                        .bound(c, 0, 3)
+                        .vectorize(c, 3)
+                    ;
+                    break;
+                }
+            }
+        }
     };
 
 };
@@ -13,22 +13,40 @@ namespace {
         Var x{"x"}, y{"y"}, c{"c"};
         Func lut_gamma{"lut_gamma"};
     public:
-        Input<Func> input{"input", Float(32), 3};
+        Input<Func> input{"input"};
         Input<float> gamma{"gamma"};
-        Output<Func> output{"output_gc", Float(32), 3};
+        Output<Func> output{"output_gc"};
+
+        // If it is defined before apply(), the gamma curve comes from this table of max16_u16 + 1 floats
+        // (e.g. computed once by ISPLuts) instead of being computed on every call.
+        Func lut_gamma_input;
+
+        static Expr gamma_curve(Expr c, Expr gamma) {
+            return pow(f32(c)/max16_f32, 1.f/gamma);
+        }
 
         void generate() {
-            lut_gamma(c) = pow(f32(c)/max16_f32, 1.f/gamma);
-            output(x, y, c) = lut_gamma(u16_sat(input(x, y, c) * max16_f32));
+            Expr curve = lut_gamma_input.defined() ? lut_gamma_input(c) : gamma_curve(c, gamma);
+            if(int_mode) {
+                lut_gamma(c) = u16_sat(curve * max16_f32 + 0.5f);
+                output(x, y, c, _) = lut_gamma(input(x, y, c, _));
+            } else {
+                lut_gamma(c) = curve;
+                output(x, y, c, _) = lut_gamma(u16_sat(input(x, y, c, _) * max16_f32));
+            }
         }
 
         void schedule() {
             if(auto_schedule) {
-                input.set_estimates({{0,4000},{0,3000},{0,3}});
-                gamma.set_estimate(2.2f);
-                output.set_estimates({{0,4000},{0,3000},{0,3}});
+                if(input.dimensions() == 3) {
+                    input.set_estimates({{0,4000},{0,3000},{0,3}});
+                    gamma.set_estimate(2.2f);
+                    output.set_estimates({{0,4000},{0,3000},{0,3}});
+                }
+            } else if(gpu_schedule(get_target())) {
+                schedule_gpu();
             } else {
-                const int vector_size = get_target().natural_vector_size<float>();
+                const int vector_size = cpu_vector_size(get_target(), pixel_type());
                 const int parallel_size = 256;
                 Var yc{"yc"};
                 Var co{"co"}, ci{"ci"};
@@ -43,11 +61,59 @@ namespace {
                         ;
                     }
                 }
+                if(!lut_gamma_input.defined() || int_mode) {
+                    lut_gamma.compute_root()
+                        .split(c, co, ci, parallel_size)
+                        .parallel(co)
+                        .vectorize(ci, get_target().natural_vector_size<float>())
+                    ;
+                }
+            }
+        }
+
+        // GPU schedules, for a target with a GPU feature: scheduler picks one of them
+        void schedule_gpu() {
+            const int num_threads = 32;
+            const int vector_size = 4;
+            const int parallel_size = 256;
+            Var xo{"xo"}, xi{"xi"}, xi2{"xi2"};
+            Var yo{"yo"}, yi{"yi"}, yi2{"yi2"};
+            Var co{"co"}, ci{"ci"}, ci2{"ci2"};
+
+            output.compute_root()
+                .split(x, xo, xi, num_threads*vector_size)
+                .split(xi, xi, xi2, vector_size)
+                .split(y, yo, yi, num_threads)
+                .reorder(xi2, xi, yi, xo, yo)
+                .gpu_blocks(xo, yo)
+                .gpu_threads(xi, yi)
+                .vectorize(xi2)
+            ;
+
+            switch (scheduler)
+            {
+            case 2:
+                break;
+
+            case 3: //compute at CPU
                 lut_gamma.compute_root()
                     .split(c, co, ci, parallel_size)
                     .parallel(co)
                     .vectorize(ci, vector_size)
                 ;
+                break;
+
+            default:
+            case 1:
+            case 4: //compute at GPU globally
+                lut_gamma.compute_root()
+                    .split(c, co, ci, num_threads*num_threads*vector_size)
+                    .split(ci, ci, ci2, vector_size)
+                    .gpu_blocks(co)
+                    .gpu_threads(ci)
+                    .vectorize(ci2)
+                ;
+                break;
             }
         }
     };
@@ -0,0 +1,3 @@
+#include "guided_filter.hpp"
+
+HALIDE_REGISTER_GENERATOR(GuidedFilter, guided_filter)
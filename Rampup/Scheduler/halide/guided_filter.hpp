@@ -0,0 +1,271 @@
+#ifndef __GUIDED_FILTER__
+#define __GUIDED_FILTER__
+
+#include "halide_base.hpp"
+#include "constants.hpp"
+
+namespace {
+    using namespace Halide;
+    using namespace Halide::ConciseCasts;
+
+    // Guided filter (He et al.) of the channels (channel_min, channel_min+channel_extent) of input, with the
+    // luma (channel 0) of input as guide: q = mean(a)*I + mean(b), a = cov(I,p)/(var(I)+eps), b = mean(p)-a*mean(I).
+    // The means are box filters of radius r from running sums, so the cost does not depend on r:
+    //  - along x, prefix sums over the whole row;
+    //  - along y, prefix sums restarted at each strip of rows of the output (plus the halo of the two box
+    //    filters, 4r+4 rows), so that every strip is computed independently. The strips have at least
+    //    strip_factor*r rows, so that the halo stays a fraction of the strip whatever r.
+    // r and eps come from the parameters of BilateralDenoise: a box of radius sqrt(3)*sigma_spatial has the
+    // variance of the gaussian of sigma_spatial, and eps = sigma_range^2.
+    class GuidedFilter : public Generator<GuidedFilter>, public HalideBase {
+    private:
+        Var x{"x"}, y{"y"}, c{"c"}, k{"k"}, l{"l"}, s{"s"};
+        RDom rx, rl_stats, rl_ab;
+        Expr strip_rows; // rows of the output per strip
+        Func stats{"stats"}, stats_bound{"stats_bound"};
+        Func cum_x_stats{"cum_x_stats"}, box_x_stats{"box_x_stats"}, cum_y_stats{"cum_y_stats"}, mean_stats{"mean_stats"};
+        Func ab{"ab"};
+        Func cum_x_ab{"cum_x_ab"}, box_x_ab{"box_x_ab"}, cum_y_ab{"cum_y_ab"}, mean_ab{"mean_ab"};
+
+        Expr to_unit(Expr e) {
+            return int_mode ? f32(e) / max16_f32 : e;
+        }
+
+        // number of pixels of the image in the box of radius r centered at (x, y)
+        Expr box_count(Expr x, Expr y, Expr r) {
+            Expr count_x = min(x + r, width - 1) - max(x - r, 0) + 1;
+            Expr count_y = min(y + r, height - 1) - max(y - r, 0) + 1;
+            return f32(max(count_x * count_y, 1));
+        }
+
+        // box_x(x, _) = sum of f(x - r, _) ... f(x + r, _) in (0, width), from the prefix sums cum_x along the row
+        void define_box_x(Func f, Func cum_x, Func box_x, Expr r) {
+            cum_x(x, _) = f(x, _);
+            cum_x(rx, _) += cum_x(rx - 1, _);
+            box_x(x, _) = cum_x(min(x + r, width - 1), _) - select(x - r - 1 >= 0, cum_x(max(x - r - 1, 0), _), 0.f);
+        }
+    public:
+        Input<Func> input{"input"};
+        Input<int32_t> width{"width"};
+        Input<int32_t> height{"height"};
+        Input<float> sigma_spatial{"sigma_spatial"};
+        Input<float> sigma_range{"sigma_range"};
+
+        Output<Func> output{"output_gf"};
+
+        GeneratorParam<int32_t> channel_min{"channel_min", 1};
+        GeneratorParam<int32_t> channel_extent{"channel_extent", 2};
+        // minimal rows of a strip, and rows per r of radius
+        GeneratorParam<int32_t> strip_size{"strip_size", 32};
+        GeneratorParam<int32_t> strip_factor{"strip_factor", 8};
+
+        void generate() {
+            const int n = channel_extent; // stats: I, p_j, I*I, I*p_j
+            Expr r = max(1, i32(1.7320508f*sigma_spatial + 0.5f));
+            Expr eps = sigma_range*sigma_range;
+            Expr halo = 2*r + 2; // rows of the strip before its first row in cum_y_stats
+            strip_rows = max(i32(strip_size), i32(strip_factor)*r);
+            rx = RDom(1, width - 1, "rx");
+
+            Expr guide = to_unit(input(x, y, 0, _));
+            Expr p_j = to_unit(input(x, y, channel_min + clamp(k - 1, 0, n - 1), _));
+            Expr ip_j = guide * to_unit(input(x, y, channel_min + clamp(k - n - 2, 0, n - 1), _));
+            stats(x, y, k, _) = select(k == 0, guide, k <= n, p_j, k == n + 1, guide*guide, ip_j);
+            stats_bound = BoundaryConditions::constant_exterior(stats, 0.f, {{0, width}, {0, height}});
+
+            // row l of the strip s is the row s*strip_rows + l - halo of the image
+            define_box_x(stats_bound, cum_x_stats, box_x_stats, r);
+            rl_stats = RDom(1, strip_rows + 2*halo - 1, "rl_stats");
+            cum_y_stats(x, l, s, k, _) = box_x_stats(x, s*strip_rows + l - halo, k, _);
+            cum_y_stats(x, rl_stats, s, k, _) += cum_y_stats(x, rl_stats - 1, s, k, _);
+            Expr row = s*strip_rows + l - halo;
+            mean_stats(x, l, s, k, _) = (cum_y_stats(x, l + r, s, k, _) - cum_y_stats(x, l - r - 1, s, k, _)) / box_count(x, row, r);
+
+            Expr j = k % n;
+            Expr mean_i = mean_stats(x, l, s, 0, _);
+            Expr mean_p = mean_stats(x, l, s, 1 + j, _);
+            Expr mean_ii = mean_stats(x, l, s, n + 1, _);
+            Expr mean_ip = mean_stats(x, l, s, n + 2 + j, _);
+            Expr a = (mean_ip - mean_i*mean_p) / (mean_ii - mean_i*mean_i + eps);
+            Expr b = mean_p - a*mean_i;
+            // a_j for k < n, b_j for k >= n, 0 outside of the image as stats_bound
+            ab(x, l, s, k, _) = select((row >= 0) && (row < height), select(k < n, a, b), 0.f);
+
+            // row m of the strip s is the row l = m + r + 1 of ab, i.e. s*strip_rows + m - r - 1 of the image
+            define_box_x(ab, cum_x_ab, box_x_ab, r);
+            rl_ab = RDom(1, strip_rows + 2*r + 1, "rl_ab");
+            cum_y_ab(x, l, s, k, _) = box_x_ab(x, l + r + 1, s, k, _);
+            cum_y_ab(x, rl_ab, s, k, _) += cum_y_ab(x, rl_ab - 1, s, k, _);
+            Expr ly = y % strip_rows;
+            Expr sy = y / strip_rows;
+            mean_ab(x, y, k, _) = (cum_y_ab(x, ly + 2*r + 1, sy, k, _) - cum_y_ab(x, ly, sy, k, _)) / box_count(x, y, r);
+
+            Expr jc = clamp(c - channel_min, 0, n - 1);
+            Expr q = mean_ab(x, y, jc, _) * guide + mean_ab(x, y, n + jc, _);
+            if(int_mode) {
+                output(x, y, c, _) = u16_sat(q * max16_f32 + 0.5f);
+            } else {
+                output(x, y, c, _) = clamp(q, 0.f, 1.f);
+            }
+        }
+
+        void schedule() {
+            if(auto_schedule) {
+                if(input.dimensions() == 3) {
+                    input.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
+                    sigma_spatial.set_estimate(5.f);
+                    sigma_range.set_estimate(0.05f);
+                    output.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
+                }
+            } else if(gpu_schedule(get_target())) {
+                schedule_gpu();
+            } else {
+                const int vector_size = cpu_vector_size(get_target(), Float(32));
+                const int n = channel_extent;
+                Var xo{"xo"}, xi{"xi"}, yo{"yo"}, yi{"yi"};
+
+                // par strip
+                //  for rows of the strip + halo
+                //   compute cum_x_stats (row)
+                //   compute cum_y_stats
+                //  for rows of the strip + halo
+                //   compute cum_x_ab (row)
+                //   compute cum_y_ab
+                //  compute output
+                if(out_define_schedule) {
+                    output
+                        .bound(c, channel_min, channel_extent)
+                        .split(y, yo, yi, strip_rows, TailStrategy::GuardWithIf)
+                        .split(x, xo, xi, cpu_vector_size(get_target(), pixel_type()))
+                        .reorder(xi, c, xo, yi, yo)
+                        .unroll(c)
+                        .vectorize(xi)
+                    ;
+                    if(out_define_compute) {
+                        output.compute_root()
+                            .parallel(yo)
+                        ;
+                    }
+                    intm_compute_level.set({output, yo});
+                }
+                cum_y_stats.compute_at(intm_compute_level)
+                    .bound(k, 0, 2*n + 2)
+                    .reorder(x, k, l, s)
+                    .vectorize(x, vector_size)
+                ;
+                cum_y_stats.update()
+                    .reorder(x, k, rl_stats, s)
+                    .vectorize(x, vector_size)
+                ;
+                // the args of cum_x are (x, _): _0 is the row and _1 the statistic
+                cum_x_stats.compute_at(LoopLevel(cum_y_stats, l, 0))
+                    .bound(_1, 0, 2*n + 2)
+                    .vectorize(x, vector_size)
+                ;
+                cum_x_stats.update()
+                    .reorder(_1, rx)
+                    .unroll(_1)
+                ;
+                cum_y_ab.compute_at(intm_compute_level)
+                    .bound(k, 0, 2*n)
+                    .reorder(x, k, l, s)
+                    .vectorize(x, vector_size)
+                ;
+                cum_y_ab.update()
+                    .reorder(x, k, rl_ab, s)
+                    .vectorize(x, vector_size)
+                ;
+                // (x, _): _0 is the row of the strip, _1 the strip and _2 the coefficient
+                cum_x_ab.compute_at(LoopLevel(cum_y_ab, l, 0))
+                    .bound(_2, 0, 2*n)
+                    .vectorize(x, vector_size)
+                ;
+                cum_x_ab.update()
+                    .reorder(_2, rx)
+                    .unroll(_2)
+                ;
+            }
+        }
+
+        // GPU schedule, for a target with a GPU feature: the prefix sums at root, with a thread per row of
+        // the image for the ones along x and per column of a strip for the ones along y
+        void schedule_gpu() {
+            const int n = channel_extent;
+            const int num_threads = 32;
+            const int num_threads_1d = 256;
+            const int vector_size = 4;
+            Var xo{"xo"}, xi{"xi"}, xi2{"xi2"};
+            Var yo{"yo"}, yi{"yi"};
+
+            output.compute_root()
+                .bound(c, channel_min, channel_extent)
+                .split(x, xo, xi, num_threads*vector_size)
+                .split(xi, xi, xi2, vector_size)
+                .split(y, yo, yi, num_threads)
+                .reorder(xi2, c, xi, yi, xo, yo)
+                .gpu_blocks(xo, yo)
+                .gpu_threads(xi, yi)
+                .vectorize(xi2)
+                .unroll(c)
+            ;
+            cum_y_stats.compute_root()
+                .bound(k, 0, 2*n + 2)
+                .split(x, xo, xi, num_threads_1d)
+                .reorder(k, xi, xo, l, s)
+                .gpu_blocks(xo, l, s)
+                .gpu_threads(xi)
+            ;
+            cum_y_stats.update()
+                .split(x, xo, xi, num_threads_1d)
+                .reorder(k, rl_stats, xi, xo, s)
+                .gpu_blocks(xo, s)
+                .gpu_threads(xi)
+            ;
+            // the args of cum_x are (x, _): _0 is the row and _1 the statistic
+            cum_x_stats.compute_root()
+                .bound(_1, 0, 2*n + 2)
+                .split(x, xo, xi, num_threads_1d)
+                .reorder(_1, xi, xo, _0)
+                .gpu_blocks(xo, _0)
+                .gpu_threads(xi)
+            ;
+            cum_x_stats.update()
+                .split(_0, yo, yi, num_threads)
+                .reorder(_1, rx, yi, yo)
+                .gpu_blocks(yo)
+                .gpu_threads(yi)
+                .unroll(_1)
+            ;
+            cum_y_ab.compute_root()
+                .bound(k, 0, 2*n)
+                .split(x, xo, xi, num_threads_1d)
+                .reorder(k, xi, xo, l, s)
+                .gpu_blocks(xo, l, s)
+                .gpu_threads(xi)
+            ;
+            cum_y_ab.update()
+                .split(x, xo, xi, num_threads_1d)
+                .reorder(k, rl_ab, xi, xo, s)
+                .gpu_blocks(xo, s)
+                .gpu_threads(xi)
+            ;
+            // (x, _): _0 is the row of the strip, _1 the strip and _2 the coefficient
+            cum_x_ab.compute_root()
+                .bound(_2, 0, 2*n)
+                .split(x, xo, xi, num_threads_1d)
+                .reorder(_2, xi, xo, _0, _1)
+                .gpu_blocks(xo, _0, _1)
+                .gpu_threads(xi)
+            ;
+            cum_x_ab.update()
+                .split(_0, yo, yi, num_threads)
+                .reorder(_2, rx, yi, yo, _1)
+                .gpu_blocks(yo, _1)
+                .gpu_threads(yi)
+                .unroll(_2)
+            ;
+        }
+    };
+};
+
+#endif
@@ -6,15 +6,75 @@
 namespace {
     using namespace Halide;
 
+    // Schedules of the stages: auto, by target (gpu for a target with a GPU feature, cpu otherwise), cpu
+    // (vectorize and parallel on the host, also for a GPU target) or gpu (gpu_blocks and gpu_threads)
+    enum class SchedulePolicy { Auto, CPU, GPU };
+
+    const std::map<std::string, SchedulePolicy> schedule_policy_names = {
+        {"auto", SchedulePolicy::Auto}, {"cpu", SchedulePolicy::CPU}, {"gpu", SchedulePolicy::GPU}
+    };
+
     class HalideBase {
     public:
         GeneratorParam<int> scheduler{"scheduler", 1};
         GeneratorParam<double> size_factor{"size_factor", 1};
+        GeneratorParam<SchedulePolicy> schedule_policy{"schedule_policy", SchedulePolicy::Auto, schedule_policy_names};
 
         GeneratorParam<bool> out_define_schedule{"out_define_schedule", true};
         GeneratorParam<bool> out_define_compute{"out_define_compute", true};
         GeneratorParam<LoopLevel> intm_compute_level{"intm_compute_level", LoopLevel::inlined()};
         GeneratorParam<LoopLevel> intm_store_level{"intm_store_level", LoopLevel::inlined()};
+
+        // Fixed-point pipeline: pixels in UQ0.16 (uint16_t, 65535 = 1.f) instead of Float(32) in (0.f,1.f)
+        GeneratorParam<bool> int_mode{"int_mode", false};
+
+        Type pixel_type() const {
+            return int_mode ? UInt(16) : Float(32);
+        }
+
+        // CPU schedules by ISA, with isa_tuning (not benchmarked yet, so off by default: the numbered
+        // schedulers keep the natural_vector_size widths they were tuned with). The vectors of
+        // natural_vector_size lanes are then unrolled twice where the register file has room for it and the
+        // vectors are short: NEON (32 registers of 128 bits) and SSE4.1/baseline x86-64 (128 bits). AVX2 and
+        // AVX-512 keep one vector, 16 registers of 256 bits and 32 of 512 bits are already filled by the
+        // stencils of demosaic and bilateral_denoise.
+        GeneratorParam<bool> isa_tuning{"isa_tuning", false};
+
+        int cpu_vector_size(const Target & target, Type type) const {
+            const int natural_vector_size = target.natural_vector_size(type);
+            if(!isa_tuning || target.has_feature(Target::AVX512_Skylake) || target.has_feature(Target::AVX2)) {
+                return natural_vector_size;
+            }
+            return 2*natural_vector_size;
+        }
+
+        // Width of the tiles of the streaming schedules (ISP stream and band), 256 or by ISA with isa_tuning
+        // for their working set of a few planes of a tile to stay in the L2: 1 MB per core on the AVX-512
+        // server parts, 256-512 KB on the AVX2 desktops and on the arm-64 cores, whose tiles are also half as
+        // wide for the 128-bit vectors of NEON.
+        int cpu_tile_width(const Target & target) const {
+            if(!isa_tuning) {
+                return 256;
+            }
+            if(target.has_feature(Target::AVX512_Skylake)) {
+                return 512;
+            }
+            if(target.arch == Target::ARM) {
+                return 128;
+            }
+            return 256;
+        }
+
+        bool gpu_schedule(const Target & target) const {
+            switch(schedule_policy.value()) {
+            case SchedulePolicy::CPU:
+                return false;
+            case SchedulePolicy::GPU:
+                return true;
+            default:
+                return target.has_gpu_feature();
+            }
+        }
     };
 };
 
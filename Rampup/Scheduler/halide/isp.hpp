@@ -3,6 +3,7 @@
 
 #include "halide_base.hpp"
 #include "constants.hpp"
+#include "color_conversion.hpp"
 #include "normalization.hpp"
 #include "black_level_subtraction.hpp"
 #include "bilinear_resize.hpp"
@@ -11,6 +12,7 @@
 #include "demosaic.hpp"
 #include "rgb_to_ycbcr.hpp"
 #include "bilateral_denoise.hpp"
+#include "guided_filter.hpp"
 #include "mix.hpp"
 #include "ycbcr_to_rgb.hpp"
 #include "color_correction.hpp"
@@ -20,12 +22,35 @@
 
 namespace {
     using namespace Halide;
-
+    using namespace Halide::ConciseCasts;
+
+    // The pipeline of the stages, from the Bayer input to the RGB output. The variants are GeneratorParams:
+    //  - the denoise (bilateral_grid, guided_filter, half_chroma) and the CFA pattern (cfa);
+    //  - luts: the tables that only depend on the parameters (lut_gamma, weights_spatial, weights_range) are
+    //    inputs, computed once by ISPLuts, as long as gamma, sigma_spatial and sigma_range do not change;
+    //  - stream: max_gray of the tone mapping is an input (statistic of the previous frame or of a preview),
+    //    so there is no reduction over the whole image and every stage from Normalization to Denormalization
+    //    is computed per tile of the output; max_gray_next is the one of a subsampled preview of this frame;
+    //  - band: stream on a band of rows of the image, so that a band can be processed as soon as it is
+    //    decoded (stream_dng in dng_io.h). input holds the rows of the band and a halo above and below it,
+    //    its min coordinate in y being its first row in the image, and height is the one of the image; output
+    //    is the crop of the output image to the rows of the band. The halo must cover the stencils of Demosaic
+    //    and BilateralDenoise (max_gaussian_width + 2 rows): the rows read out of input are clamped to it, so
+    //    that the boundary conditions of the stages (on the whole image) do not require the whole image;
+    //  - input.dim=3 (and output_isp.dim=4): a burst of frames sharing the same metadata, the frame being the
+    //    last dimension of every stage, so that the tables are computed once per call;
+    //  - packed_bits (and input.type=uint8): input holds the MIPI RAW10/12/14 bytes of the sensor, unpacked by
+    //    Normalization, so that the pipeline reads packed_bits/16 of the bytes of the uint16 pixels.
     class ISP : public Generator<ISP>, public HalideBase {
     private:
-        Var x{"x"}, y{"y"}, c{"c"};
-        Func black_level_f32{"black_level_f32"};
+        Var x{"x"}, y{"y"}, c{"c"}, f{"f"}, tile{"tile"};
+        Func black_level_f32{"black_level_f32"}, black_level_u16{"black_level_u16"};
+        Func white_balance_band{"white_balance_band"};
         Func bilateral_denoise_input{"bilateral_denoise_input"};
+        Func chroma_half{"chroma_half"}, guide_half{"guide_half"};
+        Func denoise_stage; // output of bilateral_denoise or guided_filter_denoise
+        Func preview{"preview"}, gray_preview{"gray_preview"};
+        RDom r_preview;
         std::unique_ptr<Normalization> normalization;
         std::unique_ptr<BlackLevelSubtraction> black_level_subtraction;
         std::unique_ptr<BilinearResize> bilinear_resize;
@@ -34,6 +59,7 @@ namespace {
         std::unique_ptr<Demosaic> demosaic;
         std::unique_ptr<RGB2YCbCr> rgb_to_ycbcr;
         std::unique_ptr<BilateralDenoise> bilateral_denoise;
+        std::unique_ptr<GuidedFilter> guided_filter_denoise;
         std::unique_ptr<Mix> mix;
         std::unique_ptr<YCbCr2RGB> ycbcr_to_rgb;
         std::unique_ptr<ColorCorrection> color_correction;
@@ -43,8 +69,45 @@ namespace {
 
         int mscheduler;
 
+        Input<Buffer<float>> * lut_gamma;
+        Input<Buffer<float>> * weights_spatial;
+        Input<Buffer<float>> * weights_range;
+        Input<float> * max_gray;
+        Input<int> * height; // of the image, with band
+        Output<Buffer<float>> * max_gray_next;
+
+        bool streaming() const {
+            return stream || band;
+        }
+
+        bool batch() const {
+            return input.dimensions() == 3;
+        }
+
     public:
-        Input<Buffer<uint16_t>> input{"input", 2};
+        // BilateralDenoise with a bilateral grid instead of the separable filter
+        GeneratorParam<bool> bilateral_grid{"bilateral_grid", false};
+        // GuidedFilter instead of BilateralDenoise for the chroma denoise
+        GeneratorParam<bool> guided_filter{"guided_filter", false};
+        // Chroma denoise at half resolution: Cb, Cr and the guide downsampled 2x2 after RGB2YCbCr, the
+        // denoised chroma upsampled in Mix
+        GeneratorParam<bool> half_chroma{"half_chroma", false};
+        // CFA pattern baked in at generation time (Demosaic), none: cfa_pattern at run time
+        GeneratorParam<CFA> cfa{"cfa", NONE, cfa_names};
+        // the variants above the class
+        GeneratorParam<bool> luts{"luts", false};
+        GeneratorParam<bool> stream{"stream", false};
+        GeneratorParam<bool> band{"band", false};
+        // tiles of the output with stream, 0: cpu_tile_width of the target
+        GeneratorParam<int> tile_width{"tile_width", 0};
+        GeneratorParam<int> tile_height{"tile_height", 128};
+        // distance in Bayer quads between the samples of the preview
+        GeneratorParam<int> preview_stride{"preview_stride", 8};
+        // 10, 12 or 14 (Normalization), 0: the uint16 pixels
+        GeneratorParam<int> packed_bits{"packed_bits", 0};
+
+        // input.type: uint16, uint8 with packed_bits; input.dim: 2 (x, y) or 3 (x, y, frame)
+        Input<Buffer<>> input{"input"};
         Input<Buffer<float>> lsc_map{"lsc_map", 3};
         Input<Buffer<float>> wb{"wb", 1};
         Input<Buffer<float>> ccm{"ccm", 2};
@@ -54,76 +117,261 @@ namespace {
         Input<float> gamma{"gamma"};
         Input<float> sigma_spatial{"sigma_spatial"};
         Input<float> sigma_range{"sigma_range"};
-        Output<Buffer<uint16_t>> output{"output_isp", 3};
+        Output<Buffer<uint16_t>> output{"output_isp"}; // output_isp.dim: 3 (x, y, c) or 4 (x, y, c, frame)
+
+        // in the signature, the inputs after sigma_range (the tables, max_gray, height) and max_gray_next after
+        // output_isp
+        void configure() {
+            if(luts) {
+                lut_gamma = add_input<Buffer<float>>("lut_gamma", 1); // (0, max16_u16)
+                weights_spatial = add_input<Buffer<float>>("weights_spatial", 1); // (0, max_gaussian_width)
+                weights_range = add_input<Buffer<float>>("weights_range", 1); // (0, 3*max14_u16)
+            }
+            if(streaming()) {
+                max_gray = add_input<float>("max_gray");
+            }
+            if(band) {
+                height = add_input<int>("height");
+            }
+            if(streaming()) {
+                max_gray_next = add_output<Buffer<float>>("max_gray_next", 0);
+            }
+        }
 
         void generate() {
-            mscheduler = (scheduler == 1)?16:scheduler;
+            user_assert(!streaming() || (input.dimensions() == 2)) << "ISP: stream and band take a single frame\n";
+            user_assert(!streaming() || !gpu_schedule(get_target())) << "ISP: stream and band have CPU schedules only\n";
+            user_assert(input.type() == (packed_bits ? UInt(8) : UInt(16))) << "ISP: input.type must be uint8 with packed_bits, uint16 without\n";
+            user_assert(!streaming() || !packed_bits) << "ISP: the preview of stream and band reads the uint16 pixels\n";
+            // the variants build on the schedule of scheduler 1
+            mscheduler = ((scheduler == 1) || gpu_schedule(get_target()) || streaming() || batch())?16:scheduler;
+            Expr image_width = packed_bits ? input.width() * 8 / packed_bits : Expr(input.width());
+            Expr image_height = band ? Expr(*height) : Expr(input.height());
 
             black_level_f32(c) = f32(black_level(c)) / white_level; // range (0,white_level) -> (0.f,1.f)
+            black_level_u16(c) = u16_sat(u32(black_level(c)) * max16_u16 / white_level); // range (0,white_level) -> UQ0.16
 
             normalization = create<Normalization>(); // range (0,white_level) -> (0.f,1.f)
+            normalization->int_mode.set(int_mode);
+            normalization->schedule_policy.set(schedule_policy);
+            normalization->isa_tuning.set(isa_tuning);
+            normalization->packed_bits.set(packed_bits);
             normalization->out_define_schedule.set(mscheduler < 15);
             normalization->apply(input, white_level);
 
             black_level_subtraction = create<BlackLevelSubtraction>();
+            black_level_subtraction->int_mode.set(int_mode);
+            black_level_subtraction->schedule_policy.set(schedule_policy);
+            black_level_subtraction->isa_tuning.set(isa_tuning);
             black_level_subtraction->out_define_schedule.set(mscheduler < 14);
-            black_level_subtraction->apply(normalization->output, black_level_f32);
+            black_level_subtraction->apply(normalization->output, int_mode ? black_level_u16 : black_level_f32);
 
             bilinear_resize = create<BilinearResize>();
+            bilinear_resize->int_mode.set(int_mode);
+            bilinear_resize->schedule_policy.set(schedule_policy);
+            bilinear_resize->isa_tuning.set(isa_tuning);
             bilinear_resize->out_define_schedule.set(mscheduler < 16);
-            bilinear_resize->apply(lsc_map, lsc_map.width(), lsc_map.height(), input.width()/2, input.height()/2);
+            bilinear_resize->apply(lsc_map, lsc_map.width(), lsc_map.height(), image_width/2, image_height/2);
 
             lens_shading_correction = create<LensShadingCorrection>();
+            lens_shading_correction->int_mode.set(int_mode);
+            lens_shading_correction->schedule_policy.set(schedule_policy);
+            lens_shading_correction->isa_tuning.set(isa_tuning);
             lens_shading_correction->out_define_schedule.set(mscheduler < 13);
             lens_shading_correction->apply(black_level_subtraction->output, bilinear_resize->output);
 
             white_balance = create<WhiteBalance>();
+            white_balance->int_mode.set(int_mode);
+            white_balance->schedule_policy.set(schedule_policy);
+            white_balance->isa_tuning.set(isa_tuning);
             white_balance->out_define_compute.set(mscheduler != 11);
             white_balance->out_define_schedule.set(mscheduler < 12);
             white_balance->apply(lens_shading_correction->output, wb);
 
+            Func demosaic_input = white_balance->output;
+            if(band) {
+                white_balance_band(x, y) = white_balance->output(x, clamp(y, input.dim(1).min(), input.dim(1).max()));
+                demosaic_input = white_balance_band;
+            }
+
             demosaic = create<Demosaic>(); // Bayer 2D (width, height) -> 3D (width, height, 3)
-            demosaic->apply(white_balance->output, input.width(), input.height(), cfa_pattern);
+            demosaic->cfa.set(cfa);
+            demosaic->int_mode.set(int_mode);
+            demosaic->schedule_policy.set(schedule_policy);
+            demosaic->isa_tuning.set(isa_tuning);
+            demosaic->out_define_compute.set(!streaming());
+            demosaic->apply(demosaic_input, image_width, image_height, cfa_pattern);
 
             rgb_to_ycbcr = create<RGB2YCbCr>();
+            rgb_to_ycbcr->int_mode.set(int_mode);
+            rgb_to_ycbcr->schedule_policy.set(schedule_policy);
+            rgb_to_ycbcr->isa_tuning.set(isa_tuning);
             rgb_to_ycbcr->out_define_schedule.set(mscheduler < 8);
             rgb_to_ycbcr->apply(demosaic->output);
 
-            bilateral_denoise_input(x, y, c) = rgb_to_ycbcr->output(x, y, c);
+            Func denoise_input = rgb_to_ycbcr->output;
+            Func denoise_guide = demosaic->output;
+            Expr denoise_width = image_width;
+            Expr denoise_height = image_height;
+            Expr denoise_sigma_spatial = sigma_spatial;
+            if(half_chroma) {
+                // a quarter of the pixels, sigma_spatial in half resolution pixels
+                chroma_half(x, y, c, _) = downsample(rgb_to_ycbcr->output);
+                guide_half(x, y, c, _) = downsample(demosaic->output);
+                denoise_input = chroma_half;
+                denoise_guide = guide_half;
+                denoise_width = image_width / 2;
+                denoise_height = image_height / 2;
+                denoise_sigma_spatial = sigma_spatial * 0.5f;
+            }
 
-            bilateral_denoise = create<BilateralDenoise>();
-            bilateral_denoise->apply(bilateral_denoise_input, demosaic->output, input.width(), input.height(), sigma_spatial, sigma_range);
+            Func denoise_output;
+            if(guided_filter) {
+                guided_filter_denoise = create<GuidedFilter>();
+                guided_filter_denoise->int_mode.set(int_mode);
+                guided_filter_denoise->schedule_policy.set(schedule_policy);
+                guided_filter_denoise->isa_tuning.set(isa_tuning);
+                guided_filter_denoise->out_define_compute.set(!streaming());
+                guided_filter_denoise->apply(denoise_input, denoise_width, denoise_height, denoise_sigma_spatial, sigma_range);
+                denoise_output = guided_filter_denoise->output;
+            } else {
+                bilateral_denoise_input(x, y, c, _) = denoise_input(x, y, c, _);
+
+                bilateral_denoise = create<BilateralDenoise>();
+                bilateral_denoise->int_mode.set(int_mode);
+                bilateral_denoise->schedule_policy.set(schedule_policy);
+                bilateral_denoise->isa_tuning.set(isa_tuning);
+                bilateral_denoise->bilateral_grid.set(bilateral_grid);
+                bilateral_denoise->out_define_compute.set(!streaming());
+                if(luts) {
+                    bilateral_denoise->weights_spatial_input = *weights_spatial;
+                    bilateral_denoise->weights_range_input = *weights_range;
+                }
+                bilateral_denoise->apply(bilateral_denoise_input, denoise_guide, denoise_width, denoise_height, denoise_sigma_spatial, sigma_range);
+                denoise_output = bilateral_denoise->output;
+            }
+            denoise_stage = denoise_output;
+            if(half_chroma) {
+                // the upsampling of Mix reads one sample beyond the borders
+                denoise_output = BoundaryConditions::repeat_edge(denoise_output, {{0, denoise_width}, {0, denoise_height}});
+            }
 
             mix = create<Mix>();
+            mix->int_mode.set(int_mode);
+            mix->schedule_policy.set(schedule_policy);
+            mix->isa_tuning.set(isa_tuning);
+            mix->half_chroma.set(half_chroma);
             mix->out_define_schedule.set(mscheduler < 7);
-            mix->apply(rgb_to_ycbcr->output, bilateral_denoise->output);
+            mix->apply(rgb_to_ycbcr->output, denoise_output);
 
             ycbcr_to_rgb = create<YCbCr2RGB>();
+            ycbcr_to_rgb->int_mode.set(int_mode);
+            ycbcr_to_rgb->schedule_policy.set(schedule_policy);
+            ycbcr_to_rgb->isa_tuning.set(isa_tuning);
             ycbcr_to_rgb->out_define_schedule.set(mscheduler < 6);
             ycbcr_to_rgb->apply(mix->output);
 
             color_correction = create<ColorCorrection>();
+            color_correction->int_mode.set(int_mode);
+            color_correction->schedule_policy.set(schedule_policy);
+            color_correction->isa_tuning.set(isa_tuning);
             color_correction->out_define_schedule.set(mscheduler < 5);
             color_correction->apply(ycbcr_to_rgb->output, ccm);
 
             reinhard_tone_mapping = create<ReinhardToneMapping>();
+            reinhard_tone_mapping->int_mode.set(int_mode);
+            reinhard_tone_mapping->schedule_policy.set(schedule_policy);
+            reinhard_tone_mapping->isa_tuning.set(isa_tuning);
             reinhard_tone_mapping->out_define_schedule.set(mscheduler < 4);
-            reinhard_tone_mapping->apply(color_correction->output, input.width(), input.height());
+            if(streaming()) {
+                reinhard_tone_mapping->max_gray_input = *max_gray;
+            }
+            reinhard_tone_mapping->apply(color_correction->output, image_width, image_height); // max_gray per frame
 
             gamma_correction = create<GammaCorrection>();
+            gamma_correction->int_mode.set(int_mode);
+            gamma_correction->schedule_policy.set(schedule_policy);
+            gamma_correction->isa_tuning.set(isa_tuning);
             gamma_correction->out_define_schedule.set(mscheduler < 3);
+            if(luts) {
+                gamma_correction->lut_gamma_input = *lut_gamma;
+            }
             gamma_correction->apply(reinhard_tone_mapping->output, gamma);
 
             denormalization = create<Denormalization>(); // range (0.f, 1.f) -> (0, 65535)
+            denormalization->int_mode.set(int_mode);
+            denormalization->schedule_policy.set(schedule_policy);
+            denormalization->isa_tuning.set(isa_tuning);
             denormalization->out_define_schedule.set(mscheduler < 3);
             denormalization->apply(gamma_correction->output, max16_u16);
 
-            output(x, y, c) = denormalization->output(x, y, c);
+            if(batch()) {
+                output(x, y, c, f) = denormalization->output(x, y, c, f);
+            } else {
+                output(x, y, c) = denormalization->output(x, y, c);
+            }
+
+            if(streaming()) {
+                generate_preview(image_height);
+            }
+        }
+
+        // Preview: one sample per Bayer quad every preview_stride quads, without lens shading correction,
+        // demosaic and denoise. Green is the mean of the two green pixels of the quad. With band, the
+        // max_gray_next of a band is the one of the rows of the preview whose quad is in input, and the max over
+        // the bands is the one of the whole frame.
+        void generate_preview(Expr image_height) {
+            Var qx{"qx"}, qy{"qy"}, q{"q"};
+            Expr px = 2*preview_stride*qx;
+            Expr py = 2*preview_stride*qy;
+            preview(qx, qy, q) = min(1.f,
+                max(0.f, min(1.f, f32(input(px + q%2, py + q/2)) / white_level) - black_level_f32(q)) * wb(q)
+            );
+            Expr pattern = (cfa == NONE) ? Expr(cfa_pattern) : Expr(u8(cfa.value()));
+            Expr r_idx = mux(pattern, {0, 1, 3, 2}); // RGGB, GRBG, BGGR, GBRG
+            Expr b_idx = mux(pattern, {3, 2, 0, 1});
+            Expr r = preview(qx, qy, r_idx);
+            Expr b = preview(qx, qy, b_idx);
+            Expr g = 0.5f*(preview(qx, qy, 0) + preview(qx, qy, 1) + preview(qx, qy, 2) + preview(qx, qy, 3) - r - b);
+            Expr cc_r = clamp(r * ccm(0, 0) + g * ccm(1, 0) + b * ccm(2, 0), 0.f, 1.f);
+            Expr cc_g = clamp(r * ccm(0, 1) + g * ccm(1, 1) + b * ccm(2, 1), 0.f, 1.f);
+            Expr cc_b = clamp(r * ccm(0, 2) + g * ccm(1, 2) + b * ccm(2, 2), 0.f, 1.f);
+            gray_preview(qx, qy) = rgb_to_gray(cc_r, cc_g, cc_b);
+
+            Expr qy_min = 0;
+            Expr qy_max = image_height/(2*preview_stride);
+            if(band) {
+                qy_min = (input.dim(1).min() + 2*preview_stride - 1) / (2*preview_stride);
+                qy_max = min(qy_max, (input.dim(1).min() + input.dim(1).extent() - 2) / (2*preview_stride) + 1);
+            }
+            r_preview = RDom(0, input.width()/(2*preview_stride), qy_min, max(qy_max - qy_min, 0), "r_preview");
+            (*max_gray_next)() = 1.e-5f;
+            (*max_gray_next)() = max((*max_gray_next)(), gray_preview(r_preview.x, r_preview.y));
         }
 
         void schedule() {
             if(auto_schedule) {
-                input.set_estimates({{0,4000},{0,3000}});
+                const int input_width = packed_bits ? 4000*packed_bits/8 : 4000; // bytes with packed_bits
+                if(batch()) {
+                    input.set_estimates({{0,input_width},{0,3000},{0,8}});
+                    output.set_estimates({{0,4000},{0,3000},{0,3},{0,8}});
+                } else if(band) {
+                    input.set_estimates({{0,input_width},{0,320}});
+                    output.set_estimates({{0,4000},{32,256},{0,3}});
+                    height->set_estimate(3000);
+                } else {
+                    input.set_estimates({{0,input_width},{0,3000}});
+                    output.set_estimates({{0,4000},{0,3000},{0,3}});
+                }
+                if(luts) {
+                    lut_gamma->set_estimates({{0, max16_u16 + 1}});
+                    weights_spatial->set_estimates({{0, BilateralDenoise::max_gaussian_width + 1}});
+                    weights_range->set_estimates({{0, BilateralDenoise::weights_range_size}});
+                }
+                if(streaming()) {
+                    max_gray->set_estimate(1.f);
+                    max_gray_next->set_estimates({});
+                }
                 lsc_map.set_estimates({{0,17},{0,13},{0, 4}});
                 wb.set_estimates({{0,4}});
                 black_level.set_estimates({{0,4}});
@@ -132,18 +380,34 @@ namespace {
                 sigma_spatial.set_estimate(5.f);
                 sigma_range.set_estimate(0.05f);
                 cfa_pattern.set_estimate(RGGB);
-                output.set_estimates({{0,4000},{0,3000},{0,3}});
+            } else if(gpu_schedule(get_target())) {
+                schedule_gpu();
             } else {
-                const int vector_size = get_target().natural_vector_size(Float(32));
+                const int vector_size = cpu_vector_size(get_target(), pixel_type());
                 Var xo("xo"), xi("xi"), yo("yo"), yi("yi"), yc("yc");
                 Var xoo("xoo"), yoo("yoo");
 
-                black_level_f32.compute_root()
+                (int_mode ? black_level_u16 : black_level_f32).compute_root()
                     .bound(c, 0, 4)
                     .vectorize(c, 4)
                 ;
 
-                if((mscheduler == 8) || (mscheduler >= 11)) {
+                // read by the denoise kernel taps, computed once at half resolution
+                if(half_chroma) {
+                    for(Func f : {chroma_half, guide_half}) {
+                        f.compute_root()
+                            .bound(c, 0, 3)
+                            .split(x, xo, xi, vector_size)
+                            .reorder(xi, c, xo, y)
+                            .unroll(c)
+                            .vectorize(xi)
+                            .parallel(y)
+                        ;
+                    }
+                }
+
+                // with the bilateral grid, bilateral_denoise_input is read when the grid is splatted
+                if(((mscheduler == 8) || (mscheduler >= 11)) && !bilateral_grid && !guided_filter && !half_chroma) {
                     rgb_to_ycbcr->output.in(bilateral_denoise_input).compute_at(bilateral_denoise->output, yoo)
                         .split(x, xo, xi, vector_size)
                         .reorder(xi, c, xo, y)
@@ -166,6 +430,15 @@ namespace {
                     white_balance->output.compute_at(demosaic->output, yo);
                 }
 
+                if(streaming()) {
+                    schedule_stream(vector_size);
+                    return;
+                }
+                if(batch()) {
+                    schedule_batch(vector_size);
+                    return;
+                }
+
                 switch (mscheduler)
                 {
                 case 3:
@@ -219,6 +492,111 @@ namespace {
                 }
             }
         }
+
+        // stream and band: every stage per tile of the output, but the tables (bilinear_resize) and the
+        // boundary conditions; the last band can be shorter than tile_height
+        void schedule_stream(int vector_size) {
+            const int tile_width_isa = tile_width.value() ? tile_width.value() : cpu_tile_width(get_target());
+            Var xo("xo"), xi("xi"), yo("yo"), yi("yi");
+            Var xio("xio"), xii("xii");
+
+            // par tile
+            //  compute demosaic->output (tile + halo of the denoise)
+            //  compute the denoise
+            //  compute output
+            output.compute_root()
+                .bound(c, 0, 3)
+                .split(x, xo, xi, tile_width_isa)
+                .split(y, yo, yi, tile_height, band ? TailStrategy::GuardWithIf : TailStrategy::Auto)
+                .reorder(xi, yi, xo, yo)
+                .fuse(xo, yo, tile).parallel(tile)
+                .split(xi, xio, xii, vector_size).vectorize(xii)
+                .reorder(xii, c, xio, yi, tile)
+                .unroll(c)
+            ;
+            demosaic->output.compute_at(output, tile);
+            denoise_stage.compute_at(output, tile);
+            bilinear_resize->intm_compute_level.set({demosaic->output, yo});
+            bilinear_resize->kernel_y_compute_level.set({demosaic->output, yo});
+            reinhard_tone_mapping->intm_compute_level.set({output, yi});
+        }
+
+        // burst: the frames in parallel in demosaic, the denoise and output
+        void schedule_batch(int vector_size) {
+            Var xo("xo"), xi("xi"), yo("yo"), yf("yf");
+
+            // par frame
+            //  par y: compute demosaic->output
+            // par frame
+            //  par tile: compute the denoise
+            // par frame, y
+            //  compute output
+            demosaic->output.parallel(_0);
+            denoise_stage.parallel(_0);
+            bilinear_resize->intm_compute_level.set({demosaic->output, yo});
+            bilinear_resize->kernel_y_compute_level.set({demosaic->output, yo});
+
+            output.compute_root()
+                .bound(c, 0, 3)
+                .split(x, xo, xi, vector_size).vectorize(xi)
+                .reorder(xi, c, xo, y, f)
+                .unroll(c)
+                .fuse(y, f, yf).parallel(yf)
+            ;
+            reinhard_tone_mapping->intm_compute_level.set({output, yf});
+        }
+
+        // GPU schedule, for a target with a GPU feature: the stages inlined in output (mscheduler 16), but
+        // for the ones whose GPU schedules compute them at root
+        void schedule_gpu() {
+            const int num_threads_x = 64;
+            const int num_threads_y = 16;
+            const int num_threads_1d = std::min(num_threads_x*num_threads_y,512);
+            const int vector_size = 4;
+            Var xo{"xo"}, xi{"xi"}, xi2{"xi2"};
+            Var yo{"yo"}, yi{"yi"}, yi2{"yi2"};
+            // the input of BilinearResize, uploaded with the image interface by the GPU isp test
+            if(get_target().has_feature(Target::OpenCL)) {
+                lsc_map.store_in(MemoryType::GPUTexture);
+            }
+            (int_mode ? black_level_u16 : black_level_f32).compute_root().store_in(MemoryType::GPUTexture)
+                .bound(c, 0, 4)
+                .vectorize(c, 4)
+                .gpu_single_thread()
+            ;
+            output.compute_root()
+                .split(x, xo, xi, num_threads_x*vector_size)
+                .split(xi, xi, xi2, vector_size)
+                .split(y, yo, yi, num_threads_y)
+                .reorder(xi2, xi, yi, xo, yo, c)
+                .gpu_blocks(xo, yo, c)
+                .gpu_threads(xi, yi)
+                .vectorize(xi2)
+            ;
+            if(half_chroma) {
+                for(Func f : {chroma_half, guide_half}) {
+                    f.compute_root()
+                        .bound(c, 0, 3)
+                        .split(x, xo, xi, num_threads_x*vector_size)
+                        .split(xi, xi, xi2, vector_size)
+                        .split(y, yo, yi, num_threads_y)
+                        .reorder(xi2, xi, yi, xo, yo, c)
+                        .gpu_blocks(xo, yo, c)
+                        .gpu_threads(xi, yi)
+                        .vectorize(xi2)
+                    ;
+                }
+            }
+        }
+
+    private:
+        // mean of the 2x2 block of f at (x, y, c, _) of the half resolution
+        Expr downsample(Func f) {
+            if(int_mode) {
+                return u16((u32(f(2*x, 2*y, c, _)) + f(2*x + 1, 2*y, c, _) + f(2*x, 2*y + 1, c, _) + f(2*x + 1, 2*y + 1, c, _) + 2) >> 2);
+            }
+            return (f(2*x, 2*y, c, _) + f(2*x + 1, 2*y, c, _) + f(2*x, 2*y + 1, c, _) + f(2*x + 1, 2*y + 1, c, _)) * 0.25f;
+        }
     };
 };
 
@@ -0,0 +1,3 @@
+#include "isp_luts.hpp"
+
+HALIDE_REGISTER_GENERATOR(ISPLuts, isp_luts)
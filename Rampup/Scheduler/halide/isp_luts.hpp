@@ -0,0 +1,64 @@
+#ifndef __ISP_LUTS__
+#define __ISP_LUTS__
+
+#include "halide_base.hpp"
+#include "constants.hpp"
+#include "bilateral_denoise.hpp"
+#include "gamma_correction.hpp"
+
+namespace {
+    using namespace Halide;
+
+    // Tables of ISP that only depend on the parameters. They are computed once into buffers of the
+    // caller and given to ISP (luts=true), as long as gamma, sigma_spatial and sigma_range do not change.
+    class ISPLuts : public Generator<ISPLuts>, public HalideBase {
+    private:
+        Var i{"i"};
+    public:
+        Input<float> gamma{"gamma"};
+        Input<float> sigma_spatial{"sigma_spatial"};
+        Input<float> sigma_range{"sigma_range"};
+        Output<Buffer<float>> lut_gamma{"lut_gamma", 1}; // (0, max16_u16)
+        Output<Buffer<float>> weights_spatial{"weights_spatial", 1}; // (0, max_gaussian_width)
+        Output<Buffer<float>> weights_range{"weights_range", 1}; // (0, 3*max14_u16)
+
+        void generate() {
+            lut_gamma(i) = GammaCorrection::gamma_curve(i, gamma);
+            weights_spatial(i) = BilateralDenoise::weight_spatial(i, sigma_spatial);
+            weights_range(i) = BilateralDenoise::weight_range(i, sigma_range);
+        }
+
+        void schedule() {
+            if(auto_schedule) {
+                gamma.set_estimate(2.2f);
+                sigma_spatial.set_estimate(5.f);
+                sigma_range.set_estimate(0.05f);
+                lut_gamma.set_estimates({{0, max16_u16 + 1}});
+                weights_spatial.set_estimates({{0, BilateralDenoise::max_gaussian_width + 1}});
+                weights_range.set_estimates({{0, BilateralDenoise::weights_range_size}});
+            } else {
+                const int vector_size = cpu_vector_size(get_target(), Float(32));
+                const int parallel_size = 256;
+                Var io{"io"}, ii{"ii"};
+
+                lut_gamma.compute_root()
+                    .bound(i, 0, max16_u16 + 1)
+                    .split(i, io, ii, parallel_size)
+                    .parallel(io)
+                    .vectorize(ii, vector_size)
+                ;
+                weights_spatial.compute_root()
+                    .bound(i, 0, BilateralDenoise::max_gaussian_width + 1)
+                ;
+                weights_range.compute_root()
+                    .bound(i, 0, BilateralDenoise::weights_range_size)
+                    .split(i, io, ii, parallel_size)
+                    .parallel(io)
+                    .vectorize(ii, vector_size)
+                ;
+            }
+        }
+    };
+};
+
+#endif
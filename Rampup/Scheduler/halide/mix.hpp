@@ -5,27 +5,53 @@
 
 namespace {
     using namespace Halide;
+    using namespace Halide::ConciseCasts;
 
     class Mix : public Generator<Mix>, public HalideBase {
     private:
         Var x{"x"}, y{"y"}, c{"c"};
+        Func chroma{"chroma"};
     public:
-        Input<Func> luma_input{"luma_input", Float(32), 3};
-        Input<Func> chroma_input{"chroma_input", Float(32), 3};
+        // chroma_input at half resolution (bounded), upsampled 2x2
+        GeneratorParam<bool> half_chroma{"half_chroma", false};
 
-        Output<Func> output{"output_mix", Float(32), 3};
+        Input<Func> luma_input{"luma_input"};
+        Input<Func> chroma_input{"chroma_input"};
+
+        Output<Func> output{"output_mix"};
 
         void generate() {
-            output(x, y, c) = mux(c, {luma_input(x, y, 0), chroma_input(x, y, 1), chroma_input(x, y, 2)});
+            if(half_chroma) {
+                // bilinear: the half resolution samples are at the centers of the 2x2 blocks, so each pixel
+                // takes 9/16 of the sample of its block, 3/16 of the next ones in x and y and 1/16 of the diagonal
+                Expr x0 = x / 2, y0 = y / 2;
+                Expr x1 = select(x % 2 == 0, x0 - 1, x0 + 1);
+                Expr y1 = select(y % 2 == 0, y0 - 1, y0 + 1);
+                if(int_mode) {
+                    chroma(x, y, c, _) = u16((u32(chroma_input(x0, y0, c, _)) * 9 + u32(chroma_input(x1, y0, c, _)) * 3
+                                            + u32(chroma_input(x0, y1, c, _)) * 3 + u32(chroma_input(x1, y1, c, _)) + 8) >> 4);
+                } else {
+                    chroma(x, y, c, _) = (chroma_input(x0, y0, c, _) * 9.f + chroma_input(x1, y0, c, _) * 3.f
+                                        + chroma_input(x0, y1, c, _) * 3.f + chroma_input(x1, y1, c, _)) * (1.f / 16.f);
+                }
+            } else {
+                chroma(x, y, c, _) = chroma_input(x, y, c, _);
+            }
+
+            output(x, y, c, _) = mux(c, {luma_input(x, y, 0, _), chroma(x, y, 1, _), chroma(x, y, 2, _)});
         }
 
         void schedule() {
             if(auto_schedule) {
-                luma_input.set_estimates({{0, 4000}, {0, 3000}, {0, 1}});
-                chroma_input.set_estimates({{0, 4000}, {0, 3000}, {1, 2}});
-                output.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
+                if(luma_input.dimensions() == 3) {
+                    luma_input.set_estimates({{0, 4000}, {0, 3000}, {0, 1}});
+                    chroma_input.set_estimates({{0, 4000}, {0, 3000}, {1, 2}});
+                    output.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
+                }
+            } else if(gpu_schedule(get_target())) {
+                schedule_gpu();
             } else {
-                const int vector_size = get_target().natural_vector_size<float>();
+                const int vector_size = cpu_vector_size(get_target(), pixel_type());
                 if(out_define_schedule) {
                     output
                         .bound(c, 0, 3)
@@ -40,6 +66,46 @@ namespace {
                 }
             }
         }
+
+        // GPU schedules, for a target with a GPU feature: scheduler picks one of them
+        void schedule_gpu() {
+            const int num_threads = 32;
+            const int vector_size = 4;
+            Var xo{"xo"}, xi{"xi"}, xi2{"xi2"};
+            Var yo{"yo"}, yi{"yi"};
+            switch (scheduler)
+            {
+            default:
+            case 1:
+            case 2:
+                output.compute_root()
+                    .bound(c, 0, 3)
+                    .split(x, xo, xi, num_threads*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, num_threads)
+                    .reorder(xi2, xi, yi, xo, yo, c)
+                    .gpu_threads(xi, yi)
+                    .gpu_blocks(xo, yo)
+                    .vectorize(xi2)
+                    .unroll(c)
+                ;
+                break;
+
+            case 3:
+                output.compute_root()
+                    .bound(c, 0, 3)
+                    .split(x, xo, xi, num_threads*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, num_threads)
+                    .reorder(xi2, c, xi, yi, xo, yo)
+                    .gpu_threads(xi, yi)
+                    .gpu_blocks(xo, yo)
+                    .vectorize(xi2)
+                    .unroll(c)
+                ;
+                break;
+            }
+        }
     };
 };
 
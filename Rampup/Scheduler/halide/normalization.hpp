@@ -2,6 +2,8 @@
 #define __NORMALIZATION__
 
 #include "halide_base.hpp"
+#include "constants.hpp"
+#include "unpack.hpp"
 
 namespace {
     using namespace Halide;
@@ -10,13 +12,36 @@ namespace {
     class Normalization : public Generator<Normalization>, public HalideBase {
     private:
         Var x{"x"};
+        Func raw{"raw"};
+        std::unique_ptr<Unpack> unpack;
     public:
-        Input<Buffer<uint16_t>> input{"input"};
+        // 10, 12 or 14: input holds the packed bytes of MIPI RAW10/12/14 (uint8), unpacked in this stage
+        // (Unpack), instead of the pixels (uint16)
+        GeneratorParam<int> packed_bits{"packed_bits", 0};
+
+        Input<Buffer<>> input{"input"};
         Input<uint16_t> white_level{"white_level"};
         Output<Func> output{"output_norm"};
 
         void generate() {
-            output(x, _) = min(1.f, f32(input(x, _)) / white_level);
+            if(packed_bits) {
+                unpack = create<Unpack>();
+                unpack->bits.set(packed_bits);
+                unpack->out_define_schedule.set(out_define_schedule && out_define_compute);
+                unpack->out_define_compute.set(false);
+                unpack->apply(input);
+                raw = unpack->output;
+            } else {
+                raw(x, _) = input(x, _);
+            }
+
+            if(int_mode) {
+                // (0,white_level) -> UQ0.16, scale in UQ16.16
+                Expr scale = (u32(max16_u16) << 16) / u32(white_level);
+                output(x, _) = u16((u32(min(raw(x, _), white_level)) * scale) >> 16);
+            } else {
+                output(x, _) = min(1.f, f32(raw(x, _)) / white_level);
+            }
         }
 
         void schedule() {
@@ -26,9 +51,11 @@ namespace {
                     white_level.set_estimate(1023);
                     output.set_estimates({{0,4000},{0,3000}});
                 }
+            } else if(gpu_schedule(get_target())) {
+                schedule_gpu();
             } else {
                 if(input.dimensions() == 2) {
-                    const int vector_size = get_target().natural_vector_size<float>();
+                    const int vector_size = cpu_vector_size(get_target(), pixel_type());
                     Var y = output.args()[1];
                     if(out_define_schedule) {
                         output
@@ -38,11 +65,68 @@ namespace {
                             output.compute_root()
                                 .parallel(y)
                             ;
+                            // a row of pixels unpacked before it is normalized
+                            if(packed_bits) {
+                                raw.compute_at(output, y);
+                            }
                         }
                     }
                 }
             }
         }
+
+        // GPU schedules, for a target with a GPU feature: scheduler picks one of them
+        void schedule_gpu() {
+            if(input.dimensions() == 2) {
+                const int num_threads = 32;
+                const int vector_size = 4;
+                Var xo{"xo"}, xi{"xi"}, xi2{"xi2"}, xi3{"xi3"};
+                Var yo{"yo"}, yi{"yi"}, yi2{"yi2"}, yi3{"yi3"};
+                Var y = output.args()[1];
+                if(get_target().has_feature(Target::OpenCL)) {
+                    input.store_in(MemoryType::GPUTexture);
+                }
+                switch (scheduler)
+                {
+                default:
+                case 1:
+                case 2:
+                    output.compute_root()
+                        .split(x, xo, xi, std::min(num_threads*num_threads,512)*vector_size)
+                        .split(xi, xi, xi2, vector_size)
+                        //.reorder(xi2, xi, xo, y)
+                        .gpu_blocks(xo, y)
+                        .gpu_threads(xi)
+                        .vectorize(xi2)
+                    ;
+                    break;
+
+                case 3:
+                    output.compute_root()
+                        .split(x, xo, xi, num_threads*vector_size)
+                        .split(xi, xi, xi2, vector_size)
+                        .split(y, yo, yi, num_threads)
+                        .reorder(xi2, xi, yi, xo, yo)
+                        .gpu_blocks(xo, yo)
+                        .gpu_threads(xi, yi)
+                        .vectorize(xi2)
+                    ;
+                    break;
+
+                case 4:
+                    output.compute_root()
+                        .split(x, xo, xi, num_threads)
+                        .split(y, yo, yi, num_threads*vector_size)
+                        .split(yi, yi, yi2, vector_size)
+                        .reorder(yi2, xi, yi, xo, yo)
+                        .gpu_blocks(xo, yo)
+                        .gpu_threads(xi, yi)
+                        .vectorize(yi2)
+                    ;
+                    break;
+                }
+            }
+        }
     };
 
 };
@@ -2,50 +2,122 @@
 #define __REINHARD_TONE_MAPPING__
 
 #include "halide_base.hpp"
+#include "constants.hpp"
 #include "color_conversion.hpp"
 
 namespace {
     using namespace Halide;
+    using namespace Halide::ConciseCasts;
 
     class ReinhardToneMapping : public Generator<ReinhardToneMapping>, public HalideBase {
     private:
-        Var x{"x"}, y{"y"}, c{"c"};
-        Func gray{"gray"}, max_gray{"max_gray"}, gain{"gain"};
+        Var x{"x"}, y{"y"}, c{"c"}, i{"i"};
+        Func gray{"gray"}, max_gray{"max_gray"}, gain{"gain"}, lut_gain{"lut_gain"};
         RDom r_max_gray;
+
+        // max_gray as a tree reduction: partial maxima per strip of strip_size rows and per vector lane,
+        // the strips in parallel, then the max of the partials (height/strip_size*vector_size values)
+        void schedule_max_gray_strips(int strip_size, int vector_size) {
+            Var xi{"xi"}, yo{"yo"};
+            RVar rxo{"rxo"}, rxi{"rxi"}, ryo{"ryo"}, ryi{"ryi"};
+            Func max_gray_intm = max_gray.update()
+                .split(r_max_gray.x, rxo, rxi, vector_size)
+                .split(r_max_gray.y, ryo, ryi, strip_size)
+                .rfactor({{rxi, xi}, {ryo, yo}});
+            // max_gray_intm(xi, yo) = max of gray(rxo*vector_size + xi, yo*strip_size + ryi)
+            max_gray_intm.compute_root()
+                .vectorize(xi)
+                .parallel(yo)
+            ;
+            max_gray_intm.update()
+                .reorder(xi, rxo, ryi, yo)
+                .vectorize(xi)
+                .parallel(yo)
+            ;
+            max_gray.compute_root();
+        }
     public:
-        Input<Func> input{"input", Float(32), 3};
+        Input<Func> input{"input"};
         Input<int> width{"width"};
         Input<int> height{"height"};
-        Output<Func> output{"output_rtm", Float(32), 3};
+        Output<Func> output{"output_rtm"};
+
+        // If it is defined before apply(), max_gray comes from it (e.g. the statistic of the
+        // previous frame) and the reduction over the whole image is not computed.
+        Expr max_gray_input;
 
         void generate() {
-            gray(x, y) = rgb_to_gray(input(x, y, 0), input(x, y, 1), input(x, y, 2));
+            if(int_mode) {
+                generate_int();
+                return;
+            }
 
-            r_max_gray = RDom(0, width, 0, height, "r_max_gray");
-            max_gray() = 1.e-5f;
-            max_gray() = max(max_gray(), gray(r_max_gray.x, r_max_gray.y));
+            gray(x, y, _) = rgb_to_gray(input(x, y, 0, _), input(x, y, 1, _), input(x, y, 2, _));
 
-            Expr l = gray(x, y);
-            Expr l_max = max_gray();
-            gain(x, y) = (1.f + (l / (l_max * l_max))) / (1.f + l);
+            if(max_gray_input.defined()) {
+                max_gray(_) = max(max_gray_input, 1.e-5f);
+            } else {
+                r_max_gray = RDom(0, width, 0, height, "r_max_gray");
+                // initialized from the first pixel, so that max_gray keeps the extra dimensions of the input (e.g. frames)
+                max_gray(_) = max(gray(0, 0, _), 1.e-5f);
+                max_gray(_) = max(max_gray(_), gray(r_max_gray.x, r_max_gray.y, _));
+            }
 
-            output(x, y, c) = input(x, y, c) * gain(x, y);
+            Expr l = gray(x, y, _);
+            Expr l_max = max_gray(_);
+            gain(x, y, _) = (1.f + (l / (l_max * l_max))) / (1.f + l);
+
+            output(x, y, c, _) = input(x, y, c, _) * gain(x, y, _);
+        }
+
+        // The gain only depends on the gray level, so it is a LUT of 4096 entries in UQ4.12
+        // indexed by the 12 most significant bits of the gray level.
+        void generate_int() {
+            gray(x, y, _) = rgb_to_gray_u16(input(x, y, 0, _), input(x, y, 1, _), input(x, y, 2, _));
+
+            if(max_gray_input.defined()) {
+                max_gray(_) = max(u16_sat(max_gray_input * max16_f32), u16(1));
+            } else {
+                r_max_gray = RDom(0, width, 0, height, "r_max_gray");
+                max_gray(_) = max(gray(0, 0, _), u16(1));
+                max_gray(_) = max(max_gray(_), gray(r_max_gray.x, r_max_gray.y, _));
+            }
+
+            Expr l = (f32(i) + 0.5f) * (16.f / max16_f32);
+            Expr l_max = f32(max_gray(_)) / max16_f32;
+            lut_gain(i, _) = u16_sat(one_gain_f32 * (1.f + (l / (l_max * l_max))) / (1.f + l));
+
+            gain(x, y, _) = lut_gain(gray(x, y, _) >> 4, _);
+
+            output(x, y, c, _) = u16_sat((u32(input(x, y, c, _)) * gain(x, y, _)) >> q_gain);
         }
 
         void schedule() {
             if(auto_schedule) {
-                input.set_estimates({{0,4000},{0,3000},{0,3}});
-                width.set_estimate(4000);
-                height.set_estimate(3000);
-                output.set_estimates({{0,4000},{0,3000},{0,3}});
+                if(input.dimensions() == 3) {
+                    input.set_estimates({{0,4000},{0,3000},{0,3}});
+                    width.set_estimate(4000);
+                    height.set_estimate(3000);
+                    output.set_estimates({{0,4000},{0,3000},{0,3}});
+                }
+            } else if(gpu_schedule(get_target())) {
+                schedule_gpu();
             } else {
-                const int vector_size = get_target().natural_vector_size<float>();
+                const int vector_size = cpu_vector_size(get_target(), pixel_type());
                 const int parallel_size = 2;
+                const int strip_size = 32;
                 Var xo{"xo"}, xi{"xi"};
                 RVar ryo{"ryo"}, ryi{"ryi"};
                 Func max_gray_intm, max_gray_intm_in;
 
-                switch (scheduler)
+                if(int_mode) {
+                    lut_gain.compute_root()
+                        .bound(i, 0, 4096)
+                        .vectorize(i, get_target().natural_vector_size<float>())
+                    ;
+                }
+
+                switch (max_gray_input.defined()?1:scheduler)
                 {
                 case 2:
                     output.compute_root()
@@ -198,6 +270,23 @@ namespace {
                     ;
                     break;
 
+                case 9:
+                    output.compute_root()
+                        .split(x, xo, xi, vector_size).vectorize(xi)
+                        .reorder(xi, c, xo, y)
+                        .parallel(y)
+                    ;
+                    // case 8 with strips of strip_size rows and one partial max per vector lane
+                    // par yo
+                    //  for ryi, rxo
+                    //   vec xi: compute max_gray_intm.update()
+                    // compute max_gray
+                    schedule_max_gray_strips(strip_size, vector_size);
+                    gain.compute_at(output, y)
+                        .vectorize(x, vector_size)
+                    ;
+                    break;
+
                 case 1:
                 default:
                     if(out_define_schedule) {
@@ -212,13 +301,9 @@ namespace {
                         }
                         intm_compute_level.set({output, y});
                     }
-                    max_gray_intm = max_gray.update().split(r_max_gray.y, ryo, ryi, parallel_size).rfactor(ryo, y);
-                    max_gray_intm_in = max_gray_intm.in();
-                    max_gray_intm_in.compute_root()
-                        .parallel(y)
-                    ;
-                    max_gray_intm.compute_at(max_gray_intm_in, y);
-                    max_gray.compute_root();
+                    if(!max_gray_input.defined()) {
+                        schedule_max_gray_strips(strip_size, vector_size);
+                    }
                     gain.compute_at(intm_compute_level)
                         .vectorize(x, vector_size)
                     ;
@@ -226,6 +311,242 @@ namespace {
                 }
             }
         }
+
+        // GPU schedules, for a target with a GPU feature: scheduler picks one of them
+        void schedule_gpu() {
+            const int num_threads = 32;
+            const int num_pixels = 4*num_threads;
+            const int vector_size = 4;
+            Var xo{"xo"}, xi{"xi"}, xi2{"xi2"};
+            Var yo{"yo"}, yi{"yi"};
+            RVar rxo{"rxo"}, rxi{"rxi"}, rxi2{"rxi2"};
+            RVar ryo{"ryo"}, ryi{"ryi"}, ryi2{"ryi2"};
+            Func max_gray_intm, max_gray_intm2;
+            int n;
+            max_gray.compute_root().gpu_single_thread();
+            if(int_mode) {
+                lut_gain.compute_root()
+                    .bound(i, 0, 4096)
+                    .split(i, xo, xi, num_threads*num_threads)
+                    .gpu_blocks(xo)
+                    .gpu_threads(xi)
+                ;
+            }
+            switch (max_gray_input.defined()?0:scheduler)
+            {
+            case 0: // max_gray from max_gray_input, no reduction
+                break;
+
+            case 2:
+                max_gray.update()
+                    .split(r_max_gray.x, rxo, rxi, num_threads)
+                    .split(r_max_gray.y, ryo, ryi, num_threads)
+                    .reorder(rxi, ryi, rxo, ryo)
+                    .atomic()
+                    .gpu_blocks(rxo, ryo)
+                    .gpu_threads(rxi, ryi)
+                ;
+                break;
+
+            case 3:
+                max_gray_intm = max_gray.update()
+                    .split(r_max_gray.x, rxo, rxi, num_pixels)
+                    .split(r_max_gray.y, ryo, ryi, num_pixels)
+                    .rfactor({{rxo, x}, {ryo, y}})
+                ;
+                max_gray.update().gpu_single_thread();
+                max_gray_intm.in().compute_root()
+                    .store_in(MemoryType::GPUTexture)
+                    .gpu_blocks(x, y)
+                ;
+                max_gray_intm.compute_at(max_gray_intm.in(), x)
+                    .store_in(MemoryType::GPUShared)
+                ;
+                max_gray_intm.update()
+                    .split(rxi, rxi2, rxi, num_threads)
+                    .split(ryi, ryi2, ryi, num_threads)
+                    .reorder(rxi2, ryi2, rxi, ryi)
+                    .atomic()
+                    .gpu_threads(rxi, ryi)
+                ;
+                break;
+
+            case 4:
+                max_gray_intm = max_gray.update()
+                    .split(r_max_gray.x, rxo, rxi, num_pixels)
+                    .split(r_max_gray.y, ryo, ryi, num_pixels)
+                    .rfactor({{rxo, x}, {ryo, y}})
+                ;
+                max_gray.update()
+                    .atomic()
+                    .gpu_blocks(rxo, ryo)
+                ;
+                max_gray_intm.compute_at(max_gray, rxo)
+                    .store_in(MemoryType::GPUShared)
+                ;
+                max_gray_intm.update()
+                    .split(rxi, rxi2, rxi, num_threads)
+                    .split(ryi, ryi2, ryi, num_threads)
+                    .reorder(rxi2, ryi2, rxi, ryi)
+                    .atomic()
+                    .gpu_threads(rxi, ryi)
+                ;
+                break;
+
+            case 5:
+                max_gray_intm = max_gray.update()
+                    .split(r_max_gray.x, rxo, rxi, num_pixels)
+                    .split(r_max_gray.y, ryo, ryi, num_pixels)
+                    .rfactor({{rxo, x}, {ryo, y}})
+                ;
+                max_gray.update()
+                    .atomic()
+                    .gpu_blocks(rxo, ryo)
+                ;
+                max_gray_intm.compute_at(max_gray, rxo)
+                    .store_in(MemoryType::GPUShared)
+                ;
+                n = 1;
+                while(n < num_threads) {
+                    Var dx("dx"+std::to_string(n)), dy("dy"+std::to_string(n));
+                    Func max_gray_intm_block = max_gray_intm.update()
+                        .split(rxi, rxi, rxi2, 2)
+                        .split(ryi, ryi, ryi2, 2)
+                        .rfactor({{rxi2, dx}, {ryi2, dy}})
+                    ;
+                    max_gray_intm.update()
+                        .unroll(rxi2)
+                        .unroll(ryi2)
+                    ;
+                    for(int i = max_gray_intm_block.dimensions() - 4; i >= 2; i -= 2)
+                    {
+                        Var dx0 = max_gray_intm_block.args()[i];
+                        Var dy0 = max_gray_intm_block.args()[i+1];
+                        max_gray_intm_block.in().fuse(dx0, dx, dx);
+                        max_gray_intm_block.in().fuse(dy0, dy, dy);
+                    }
+                    max_gray_intm_block.in().compute_at(max_gray, rxo)
+                        .store_in(MemoryType::GPUShared)
+                        .gpu_threads(dx, dy)
+                    ;
+                    max_gray_intm_block.compute_at(max_gray_intm_block.in(), dx)
+                        .store_in(MemoryType::Register)
+                    ;
+                    max_gray_intm = max_gray_intm_block;
+                    n *= 2;
+                }
+                max_gray_intm.update()
+                    .unroll(rxi)
+                    .unroll(ryi)
+                ;
+                break;
+
+            default:
+            case 6:
+            case 7:
+            case 8:
+                max_gray_intm = max_gray.update()
+                    .split(r_max_gray.x, rxo, rxi, num_pixels)
+                    .split(r_max_gray.y, ryo, ryi, num_pixels)
+                    .rfactor({{rxo, x}, {ryo, y}})
+                ;
+                max_gray.update()
+                    .atomic()
+                    .gpu_blocks(rxo, ryo)
+                ;
+                max_gray_intm.compute_at(max_gray, rxo)
+                    .store_in(MemoryType::GPUShared)
+                ;
+                n = 1;
+                while(n < num_threads) {
+                    Var dx("dx"+std::to_string(n));
+                    Func max_gray_intm_block = max_gray_intm.update()
+                        .split(rxi, rxi, rxi2, 2)
+                        .rfactor(rxi2, dx)
+                    ;
+                    max_gray_intm.update()
+                        .unroll(rxi2)
+                    ;
+                    for(int i = max_gray_intm_block.dimensions() - 2; i >= 2; i--)
+                    {
+                        Var dx0 = max_gray_intm_block.args()[i];
+                        max_gray_intm_block.in().fuse(dx0, dx, dx);
+                    }
+                    max_gray_intm_block.in().compute_at(max_gray, rxo)
+                        .store_in(MemoryType::GPUShared)
+                        .gpu_threads(dx)
+                    ;
+                    max_gray_intm_block.compute_at(max_gray_intm_block.in(), dx)
+                        .store_in(MemoryType::Register)
+                    ;
+                    max_gray_intm = max_gray_intm_block;
+                    n *= 2;
+                }
+                n = 1;
+                while(n < num_threads) {
+                    Var dy("dy"+std::to_string(n));
+                    Func max_gray_intm_block = max_gray_intm.update()
+                        .split(ryi, ryi, ryi2, 2)
+                        .rfactor(ryi2, dy)
+                    ;
+                    max_gray_intm.update()
+                        .unroll(ryi2)
+                    ;
+                    for(int i = max_gray_intm_block.dimensions() - 2; i >= 2; i--)
+                    {
+                        Var dy0 = max_gray_intm_block.args()[i];
+                        max_gray_intm_block.in().fuse(dy0, dy, dy);
+                    }
+                    max_gray_intm_block.in().compute_at(max_gray, rxo)
+                        .store_in(MemoryType::GPUShared)
+                        .gpu_threads(dy)
+                    ;
+                    max_gray_intm_block.compute_at(max_gray_intm_block.in(), dy)
+                        .store_in(MemoryType::Register)
+                    ;
+                    max_gray_intm = max_gray_intm_block;
+                    n *= 2;
+                }
+                max_gray_intm.update()
+                    .unroll(rxi)
+                    .unroll(ryi)
+                ;
+                break;
+            }
+            output.compute_root()
+                .bound(c, 0, 3)
+                .split(x, xo, xi, num_threads*vector_size)
+                .split(xi, xi, xi2, vector_size)
+                .split(y, yo, yi, num_threads)
+                .reorder(xi2, c, xi, yi, xo, yo)
+                .gpu_threads(xi, yi)
+                .gpu_blocks(xo, yo)
+                .vectorize(xi2)
+            ;
+            switch(scheduler) {
+                default:
+                case 2:
+                case 3:
+                case 4:
+                case 5:
+                case 6:
+                    break;
+
+                case 7:
+                    gain.compute_at(output, xi)
+                        .store_in(MemoryType::GPUShared)
+                        .vectorize(x)
+                    ;
+                    break;
+
+                case 8:
+                    gain.compute_at(output, xi)
+                        .store_in(MemoryType::Register)
+                        .vectorize(x)
+                    ;
+                    break;
+            }
+        }
     };
 
 };
@@ -11,28 +11,32 @@ namespace {
     private:
         Var x{"x"}, y{"y"}, c{"c"};
     public:
-        Input<Func> input{"input", Float(32), 3};
+        Input<Func> input{"input"};
 
-        Output<Func> output{"output_r2y", Float(32), 3};
+        Output<Func> output{"output_r2y"};
 
         void generate() {
-            Expr r = input(x, y, 0);
-            Expr g = input(x, y, 1);
-            Expr b = input(x, y, 2);
+            Expr r = input(x, y, 0, _);
+            Expr g = input(x, y, 1, _);
+            Expr b = input(x, y, 2, _);
 
-            Expr yy = rgb_to_gray(r, g, b);
-            Expr cb = rgb_to_cb(r, g, b);
-            Expr cr = rgb_to_cr(r, g, b);
+            Expr yy = int_mode ? rgb_to_gray_u16(r, g, b) : rgb_to_gray(r, g, b);
+            Expr cb = int_mode ? rgb_to_cb_u16(r, g, b) : rgb_to_cb(r, g, b);
+            Expr cr = int_mode ? rgb_to_cr_u16(r, g, b) : rgb_to_cr(r, g, b);
 
-            output(x, y, c) = mux(c, {yy, cb, cr});
+            output(x, y, c, _) = mux(c, {yy, cb, cr});
         }
 
         void schedule() {
             if (auto_schedule) {
-                input.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
-                output.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
+                if(input.dimensions() == 3) {
+                    input.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
+                    output.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
+                }
+            } else if(gpu_schedule(get_target())) {
+                schedule_gpu();
             } else {
-                const int vector_size = get_target().natural_vector_size<float>();
+                const int vector_size = cpu_vector_size(get_target(), pixel_type());
                 Var xo{"xo"}, xi{"xi"};
 
                 if(out_define_schedule) {
@@ -51,6 +55,59 @@ namespace {
                 }
             }
         }
+
+        // GPU schedules, for a target with a GPU feature: scheduler picks one of them
+        void schedule_gpu() {
+            const int num_threads = 32;
+            const int vector_size = 4;
+            Var xo{"xo"}, xi{"xi"}, xi2{"xi2"};
+            Var yo{"yo"}, yi{"yi"};
+            Var co{"co"}, ci{"ci"};
+            switch (scheduler)
+            {
+            case 2:
+                output.compute_root()
+                    .bound(c, 0, 3)
+                    .split(x, xo, xi, num_threads*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, num_threads)
+                    .reorder(xi2, xi, yi, xo, yo, c)
+                    .gpu_threads(xi, yi)
+                    .gpu_blocks(xo, yo)
+                    .vectorize(xi2)
+                    .unroll(c)
+                ;
+                break;
+
+            default:
+            case 1:
+            case 3:
+                output.compute_root()
+                    .bound(c, 0, 3)
+                    .split(x, xo, xi, num_threads*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, num_threads)
+                    .reorder(xi2, c, xi, yi, xo, yo)
+                    .gpu_threads(xi, yi)
+                    .gpu_blocks(xo, yo)
+                    .vectorize(xi2)
+                    .unroll(c)
+                ;
+                break;
+
+            case 4:
+                output.compute_root()
+                    .bound(c, 0, 3)
+                    .split(x, xo, xi, num_threads)
+                    .split(y, yo, yi, num_threads)
+                    .reorder(c, xi, yi, xo, yo)
+                    .gpu_threads(xi, yi)
+                    .gpu_blocks(xo, yo)
+                    .split(c, co, ci, 3).vectorize(ci)
+                ;
+                break;
+            }
+        }
     };
 };
 
@@ -0,0 +1,3 @@
+#include "unpack.hpp"
+
+HALIDE_REGISTER_GENERATOR(Unpack, unpack)
@@ -0,0 +1,80 @@
+#ifndef __UNPACK__
+#define __UNPACK__
+
+#include "halide_base.hpp"
+
+namespace {
+    using namespace Halide;
+    using namespace Halide::ConciseCasts;
+
+    // MIPI RAW10/RAW12/RAW14 (bytes of the sensor) -> uint16. The pixels come in groups of n (4, 2 and 4) in
+    // n*bits/8 bytes: first the 8 most significant bits of each pixel, then their bits - 8 least significant
+    // bits, from the lowest bits of the next bytes for the first pixel.
+    //  RAW10: P0[9:2] P1[9:2] P2[9:2] P3[9:2] P3[1:0]P2[1:0]P1[1:0]P0[1:0]
+    //  RAW12: P0[11:4] P1[11:4] P1[3:0]P0[3:0]
+    //  RAW14: P0[13:6] P1[13:6] P2[13:6] P3[13:6] then 24 bits P3[5:0]P2[5:0]P1[5:0]P0[5:0]
+    // The pixels of a group are unrolled, so that the bytes are loaded with a constant stride in each vector.
+    class Unpack : public Generator<Unpack>, public HalideBase {
+    private:
+        Var x{"x"}, xo{"xo"}, xi{"xi"};
+
+        int group_pixels() const {
+            return (bits == 12) ? 2 : 4;
+        }
+    public:
+        GeneratorParam<int> bits{"bits", 10};
+
+        Input<Buffer<uint8_t>> input{"input"}; // rows of packed bytes
+        Output<Func> output{"output_unpack"};
+
+        void generate() {
+            user_assert((bits == 10) || (bits == 12) || (bits == 14)) << "Unpack: bits must be 10, 12 or 14\n";
+            const int n = group_pixels();
+            const int group_bytes = n * bits / 8;
+            const int lsb_bits = bits - 8;
+
+            Expr base = (x / n) * group_bytes;
+            Expr i = x % n;
+            // least significant bits of the pixel i from bit i*lsb_bits of the bytes after the n first ones
+            Expr k = (i * lsb_bits) / 8;
+            Expr shift = (i * lsb_bits) % 8;
+            Expr lsb_lo = u16(input(base + n + k, _));
+            Expr lsb_hi = u16(input(base + n + min(k + 1, group_bytes - n - 1), _));
+            Expr lsb = ((lsb_lo | (lsb_hi << 8)) >> shift) & ((1 << lsb_bits) - 1);
+            output(x, _) = (u16(input(base + i, _)) << lsb_bits) | lsb;
+        }
+
+        void schedule() {
+            if(auto_schedule) {
+                if(input.dimensions() == 2) {
+                    input.set_estimates({{0,4000*bits/8},{0,3000}});
+                    output.set_estimates({{0,4000},{0,3000}});
+                }
+            } else {
+                if(input.dimensions() == 2) {
+                    const int vector_size = cpu_vector_size(get_target(), UInt(16));
+                    Var y = output.args()[1];
+                    // x = n*xo + xi: with aligned bounds, x/n = xo and x%n = xi
+                    if(out_define_schedule) {
+                        output
+                            .split(x, xo, xi, group_pixels(), TailStrategy::RoundUp)
+                            .unroll(xi)
+                            .vectorize(xo, vector_size)
+                        ;
+                        if(out_define_compute) {
+                            output.output_buffer().dim(0).set_min(0);
+                            output.compute_root()
+                                .parallel(y)
+                            ;
+                        } else {
+                            output.align_bounds(x, group_pixels());
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+};
+
+#endif
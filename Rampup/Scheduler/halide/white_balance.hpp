@@ -2,31 +2,48 @@
 #define __WHITE_BALANCE__
 
 #include "halide_base.hpp"
+#include "constants.hpp"
 
 namespace {
     using namespace Halide;
+    using namespace Halide::ConciseCasts;
 
     class WhiteBalance : public Generator<WhiteBalance>, public HalideBase {
     private:
-        Var x{"x"}, y{"y"};
+        Var x{"x"}, y{"y"}, i{"i"};
+        Func white_balance_u16{"white_balance_u16"};
     public:
-        Input<Func> input{"input", Float(32), 2};
+        Input<Func> input{"input"};
         Input<Buffer<float>> white_balance{"white_balance", 1};
-        Output<Func> output{"output_wb", Float(32), 2};
+        Output<Func> output{"output_wb"};
 
         void generate() {
-            output(x, y) = min(1.f, input(x, y) * white_balance((x % 2) + (y % 2)*2));
+            if(int_mode) {
+                // UQ0.16 * UQ4.12 -> UQ0.16
+                white_balance_u16(i) = u16_sat(white_balance(i) * one_gain_f32);
+                output(x, y, _) = u16_sat((u32(input(x, y, _)) * white_balance_u16((x % 2) + (y % 2)*2)) >> q_gain);
+            } else {
+                output(x, y, _) = min(1.f, input(x, y, _) * white_balance((x % 2) + (y % 2)*2));
+            }
         }
 
         void schedule() {
             if(auto_schedule) {
-                input.set_estimates({{0,4000},{0,3000}});
-                white_balance.set_estimates({{0,4}});
-                output.set_estimates({{0,4000},{0,3000}});
+                if(input.dimensions() == 2) {
+                    input.set_estimates({{0,4000},{0,3000}});
+                    white_balance.set_estimates({{0,4}});
+                    output.set_estimates({{0,4000},{0,3000}});
+                }
+            } else if(gpu_schedule(get_target())) {
+                schedule_gpu();
             } else {
-                const int vector_size = get_target().natural_vector_size(Float(32));
+                const int vector_size = cpu_vector_size(get_target(), pixel_type());
                 Var xo("xo"), xi("xi"), yo("yo"), yi("yi");
 
+                if(int_mode) {
+                    white_balance_u16.compute_root();
+                }
+
                 switch (scheduler)
                 {
                 case 2:
@@ -68,6 +85,156 @@ namespace {
 
             }
         }
+
+        // GPU schedules, for a target with a GPU feature: scheduler picks one of them
+        void schedule_gpu() {
+            const int num_threads = 32;
+            const int vector_size = 4;
+            Var xo{"xo"}, xi{"xi"}, xi2{"xi2"}, xi3{"xi3"};
+            Var yo{"yo"}, yi{"yi"}, yi2{"yi2"}, yi3{"yi3"};
+            if(get_target().has_feature(Target::OpenCL)) {
+                white_balance.store_in(MemoryType::GPUTexture);
+            }
+            switch (scheduler)
+            {
+            default:
+            case 1:
+            case 2:
+                output.compute_root()
+                    .split(x, xo, xi, std::min(num_threads*num_threads,512)*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    //.reorder(xi2, xi, xo, y)
+                    .gpu_blocks(xo, y)
+                    .gpu_threads(xi)
+                    .vectorize(xi2)
+                ;
+                break;
+
+            case 3:
+                output.compute_root()
+                    .align_bounds(x, 2, 0)
+                    .align_bounds(y, 2, 0)
+                    .split(x, xo, xi, std::min(num_threads*num_threads,256)*vector_size*2)
+                    .split(xi, xi, xi2, vector_size*2)
+                    .split(xi2, xi2, xi3, 2)
+                    .split(y, yo, yi, 2)
+                    .reorder(xi3, yi, xi2, xi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi)
+                    .vectorize(xi2)
+                    .unroll(yi)
+                    .unroll(xi3)
+                ;
+                break;
+
+            case 4:
+                output.compute_root()
+                    .align_bounds(x, 2, 0)
+                    .align_bounds(y, 2, 0)
+                    .split(x, xo, xi, std::min(num_threads*num_threads,512)*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, 2)
+                    .reorder(yi, xi2, xi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi)
+                    .vectorize(xi2)
+                    .unroll(yi)
+                ;
+                break;
+
+            case 5:
+                output.compute_root()
+                    .split(x, xo, xi, num_threads*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, num_threads)
+                    .reorder(xi2, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(xi2)
+                ;
+                break;
+
+            case 6:
+                output.compute_root()
+                    .align_bounds(x, 2, 0)
+                    .align_bounds(y, 2, 0)
+                    .split(x, xo, xi, num_threads*vector_size*2)
+                    .split(xi, xi, xi2, vector_size*2)
+                    .split(xi2, xi2, xi3, 2)
+                    .split(y, yo, yi, num_threads*2)
+                    .split(yi, yi, yi2, 2)
+                    .reorder(xi3, yi2, xi2, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(xi2)
+                    .unroll(yi2)
+                    .unroll(xi3)
+                ;
+                break;
+
+            case 7:
+                output.compute_root()
+                    .align_bounds(x, 2, 0)
+                    .align_bounds(y, 2, 0)
+                    .split(x, xo, xi, num_threads*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, num_threads*2)
+                    .split(yi, yi, yi2, 2)
+                    .reorder(yi2, xi2, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(xi2)
+                    .unroll(yi2)
+                ;
+                break;
+
+            case 8:
+                output.compute_root()
+                    .split(x, xo, xi, num_threads)
+                    .split(y, yo, yi, num_threads*vector_size)
+                    .split(yi, yi, yi2, vector_size)
+                    .reorder(yi2, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(yi2)
+                ;
+                break;
+
+            case 9:
+                output.compute_root()
+                    .align_bounds(x, 2, 0)
+                    .align_bounds(y, 2, 0)
+                    .split(x, xo, xi, num_threads*2)
+                    .split(xi, xi, xi2, 2)
+                    .split(y, yo, yi, num_threads*vector_size*2)
+                    .split(yi, yi, yi2, vector_size*2)
+                    .split(yi2, yi2, yi3, 2)
+                    .reorder(xi2, yi3, yi2, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(yi2)
+                    .unroll(yi3)
+                    .unroll(xi2)
+                ;
+                break;
+
+            case 10:
+                output.compute_root()
+                    .align_bounds(x, 2, 0)
+                    .align_bounds(y, 2, 0)
+                    .split(x, xo, xi, num_threads)
+                    .split(y, yo, yi, num_threads*vector_size*2)
+                    .split(yi, yi, yi2, vector_size*2)
+                    .split(yi2, yi2, yi3, 2)
+                    .reorder(yi3, yi2, xi, yi, xo, yo)
+                    .gpu_blocks(xo, yo)
+                    .gpu_threads(xi, yi)
+                    .vectorize(yi2)
+                    .unroll(yi3)
+                ;
+                break;
+            }
+        }
     };
 
 };
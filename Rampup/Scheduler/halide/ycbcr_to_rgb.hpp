@@ -11,28 +11,32 @@ namespace {
     private:
         Var x{"x"}, y{"y"}, c{"c"};
     public:
-        Input<Func> input{"input", Float(32), 3};
+        Input<Func> input{"input"};
 
-        Output<Func> output{"output_y2r", Float(32), 3};
+        Output<Func> output{"output_y2r"};
 
         void generate() {
-            Expr yy = input(x, y, 0);
-            Expr cb = input(x, y, 1);
-            Expr cr = input(x, y, 2);
+            Expr yy = input(x, y, 0, _);
+            Expr cb = input(x, y, 1, _);
+            Expr cr = input(x, y, 2, _);
 
-            Expr r = ycbcr_to_r(yy, cb, cr);
-            Expr g = ycbcr_to_g(yy, cb, cr);
-            Expr b = ycbcr_to_b(yy, cb, cr);
+            Expr r = int_mode ? ycbcr_to_r_u16(yy, cb, cr) : ycbcr_to_r(yy, cb, cr);
+            Expr g = int_mode ? ycbcr_to_g_u16(yy, cb, cr) : ycbcr_to_g(yy, cb, cr);
+            Expr b = int_mode ? ycbcr_to_b_u16(yy, cb, cr) : ycbcr_to_b(yy, cb, cr);
 
-            output(x, y, c) = mux(c, {r, g, b});
+            output(x, y, c, _) = mux(c, {r, g, b});
         }
 
         void schedule() {
             if (auto_schedule) {
-                input.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
-                output.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
+                if(input.dimensions() == 3) {
+                    input.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
+                    output.set_estimates({{0, 4000}, {0, 3000}, {0, 3}});
+                }
+            } else if(gpu_schedule(get_target())) {
+                schedule_gpu();
             } else {
-                const int vector_size = get_target().natural_vector_size<float>();
+                const int vector_size = cpu_vector_size(get_target(), pixel_type());
                 Var xo{"xo"}, xi{"xi"};
 
                 if(out_define_schedule) {
@@ -52,6 +56,59 @@ namespace {
 
             }
         }
+
+        // GPU schedules, for a target with a GPU feature: scheduler picks one of them
+        void schedule_gpu() {
+            const int num_threads = 32;
+            const int vector_size = 4;
+            Var xo{"xo"}, xi{"xi"}, xi2{"xi2"};
+            Var yo{"yo"}, yi{"yi"};
+            Var co{"co"}, ci{"ci"};
+            switch (scheduler)
+            {
+            case 2:
+                output.compute_root()
+                    .bound(c, 0, 3)
+                    .split(x, xo, xi, num_threads*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, num_threads)
+                    .reorder(xi2, xi, yi, xo, yo, c)
+                    .gpu_threads(xi, yi)
+                    .gpu_blocks(xo, yo)
+                    .vectorize(xi2)
+                    .unroll(c)
+                ;
+                break;
+
+            default:
+            case 1:
+            case 3:
+                output.compute_root()
+                    .bound(c, 0, 3)
+                    .split(x, xo, xi, num_threads*vector_size)
+                    .split(xi, xi, xi2, vector_size)
+                    .split(y, yo, yi, num_threads)
+                    .reorder(xi2, c, xi, yi, xo, yo)
+                    .gpu_threads(xi, yi)
+                    .gpu_blocks(xo, yo)
+                    .vectorize(xi2)
+                    .unroll(c)
+                ;
+                break;
+
+            case 4:
+                output.compute_root()
+                    .bound(c, 0, 3)
+                    .split(x, xo, xi, num_threads)
+                    .split(y, yo, yi, num_threads)
+                    .reorder(c, xi, yi, xo, yo)
+                    .gpu_threads(xi, yi)
+                    .gpu_blocks(xo, yo)
+                    .split(c, co, ci, 3).vectorize(ci)
+                ;
+                break;
+            }
+        }
     };
 };
 
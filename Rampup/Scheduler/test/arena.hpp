@@ -0,0 +1,147 @@
+#ifndef __ARENA__
+#define __ARENA__
+
+#include "HalideRuntime.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+    // Pool of the blocks that the pipelines allocate through halide_malloc. A freed block is kept and handed
+    // out again for a request of at least half of its size, so that the scratch of a stage run in a loop
+    // (run_benchmark), or of the next stage, reuses the pages already touched instead of faulting in new
+    // ones. The blocks are never given back to the system.
+    // With a huge_page_threshold, the blocks of at least that size (the compute_root intermediates of a
+    // frame) are mapped on 2 MB boundaries and advised as transparent huge pages, so that a full-frame
+    // plane takes a few TLB entries instead of thousands. They are regular pages when the kernel does not
+    // give huge pages (madvise fails, THP disabled) and come from aligned_alloc when mmap fails.
+    class Arena {
+    public:
+        static constexpr size_t alignment = 128; // >= halide_malloc_alignment()
+        static constexpr size_t huge_page_size = 2 << 20;
+
+        // 0: no huge pages
+        size_t huge_page_threshold = 0;
+
+        void * allocate(size_t size) {
+            size = (size + alignment - 1) / alignment * alignment;
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = free_blocks.lower_bound(size);
+            if((it != free_blocks.end()) && (it->first <= 2 * size)) {
+                void * ptr = it->second;
+                used[ptr] = it->first;
+                free_blocks.erase(it);
+                return ptr;
+            }
+            void * ptr = nullptr;
+            if((huge_page_threshold > 0) && (size >= huge_page_threshold)) {
+                size = (size + huge_page_size - 1) / huge_page_size * huge_page_size;
+                ptr = map_huge_pages(size);
+            }
+            if(ptr == nullptr) {
+                ptr = aligned_alloc(alignment, size);
+            }
+            if(ptr != nullptr) {
+                used[ptr] = size;
+                reserved += size;
+            }
+            return ptr;
+        }
+
+        // false if ptr is not a block of the arena
+        bool release(void * ptr) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = used.find(ptr);
+            if(it == used.end()) {
+                return false;
+            }
+            free_blocks.emplace(it->second, ptr);
+            used.erase(it);
+            return true;
+        }
+
+        // bytes allocated from the system
+        size_t reserved_bytes() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return reserved;
+        }
+
+        // bytes of them advised as huge pages
+        size_t huge_page_bytes() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return huge;
+        }
+
+    private:
+        // size bytes on a huge_page_size boundary, the mapping trimmed to them
+        void * map_huge_pages(size_t size) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+            const size_t mapped = size + huge_page_size;
+            void * mem = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(mem == MAP_FAILED) {
+                return nullptr;
+            }
+            char * begin = static_cast<char *>(mem);
+            char * ptr = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(begin) + huge_page_size - 1) & ~(huge_page_size - 1));
+            if(ptr > begin) {
+                munmap(begin, ptr - begin);
+            }
+            const size_t tail = (begin + mapped) - (ptr + size);
+            if(tail > 0) {
+                munmap(ptr + size, tail);
+            }
+            if(madvise(ptr, size, MADV_HUGEPAGE) == 0) {
+                huge += size;
+            }
+            return ptr;
+#else
+            (void)size;
+            return nullptr;
+#endif
+        }
+
+        std::mutex mutex;
+        std::multimap<size_t, void *> free_blocks; // by size
+        std::unordered_map<void *, size_t> used;
+        size_t reserved = 0;
+        size_t huge = 0;
+    };
+
+    // never destroyed, the runtime may still free blocks at exit
+    Arena & arena() {
+        static Arena * instance = new Arena();
+        return *instance;
+    }
+
+    void * arena_malloc(void *, size_t size) {
+        return arena().allocate(size);
+    }
+
+    // The blocks allocated before the arena was installed come from halide_default_malloc, whose pointer is
+    // not the one of malloc (it is aligned, the original one stored before it): they go back to
+    // halide_default_free.
+    void arena_free(void * user_context, void * ptr) {
+        if((ptr != nullptr) && !arena().release(ptr)) {
+            halide_default_free(user_context, ptr);
+        }
+    }
+
+    // halide_malloc and halide_free of the pipelines through arena(). BENCHMARK_HUGE_PAGES (MB, 0 by default)
+    // is the huge_page_threshold.
+    void use_arena() {
+        const char * huge_pages = getenv("BENCHMARK_HUGE_PAGES");
+        arena().huge_page_threshold = (huge_pages && *huge_pages) ? size_t(atoi(huge_pages)) << 20 : 0;
+        halide_set_custom_malloc(arena_malloc);
+        halide_set_custom_free(arena_free);
+    }
+}
+
+#endif
@@ -0,0 +1,57 @@
+#include "HalideBuffer.h"
+#include "read_metadata.hpp"
+
+#include <string>
+
+using namespace Halide::Runtime;
+
+// The container of make calibration (the .cal next to the .txt) against the .mat (load_image) and the .txt
+// (read_metadata) it is packed from: the buffers must have the same dimensions and values.
+template<typename T>
+int compare(const char * name, const Buffer<T> & expected, const Buffer<T> & actual) {
+    if(expected.dimensions() != actual.dimensions()) {
+        printf("%s: %d dimensions instead of %d\n", name, actual.dimensions(), expected.dimensions());
+        return 1;
+    }
+    for(int i = 0; i < expected.dimensions(); i++) {
+        if(expected.dim(i).extent() != actual.dim(i).extent()) {
+            printf("%s: extent %d of dimension %d instead of %d\n", name, actual.dim(i).extent(), i, expected.dim(i).extent());
+            return 1;
+        }
+    }
+    int errors = 0;
+    expected.for_each_element([&](const int * pos) {
+        errors += (expected(pos) != actual(pos));
+    });
+    printf("%s: %d values differ\n", name, errors);
+    return errors ? 1 : 0;
+}
+
+int main(int argc, char ** argv) {
+
+    if(argc < 4) {
+        puts("Usage: ./test_calibration path_input path_lsc_map path_input_metadata [...]");
+        return 1;
+    }
+    const char * path_lsc_map = argv[2];
+    const char * path_input_metadata = argv[3];
+    const std::string path_metadata = path_input_metadata;
+    const size_t dot = path_metadata.rfind('.');
+    const std::string path_cal = path_metadata.substr(0, dot) + ".cal";
+
+    Calibration expected;
+    if(!load_calibration(path_lsc_map, path_input_metadata, expected)) {
+        return 1;
+    }
+    Calibration actual;
+    if(!read_calibration(path_cal.c_str(), actual)) {
+        return 1;
+    }
+
+    int failures = 0;
+    failures += compare("wb", expected.wb, actual.wb);
+    failures += compare("ccm", expected.ccm, actual.ccm);
+    failures += compare("lsc_map", expected.lsc_map, actual.lsc_map);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,5 @@
+#include "test.hpp"
+
+int main(int argc, char ** argv) {
+    return test<GF>(argc, argv);
+}
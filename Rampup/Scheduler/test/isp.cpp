@@ -4,6 +4,9 @@
 #include "transform_wb.hpp"
 #include "halide_image_io.h"
 #include "run_benchmark.hpp"
+#include "arena.hpp"
+#include "numa.hpp"
+#include "multi_target.hpp"
 
 using namespace Halide::Runtime;
 using namespace Halide::Tools;
@@ -28,18 +31,38 @@ int main(int argc, char ** argv) {
     const int width = input.buffer.width();
     const int height = input.buffer.height();
     const int numel = input.buffer.number_of_elements();
-    Buffer<float> lsc_map = load_image(path_lsc_map);
-    Buffer<float> wb_rgb(3);
+    Calibration calibration;
+    if(!load_calibration(path_lsc_map, path_input_metadata, calibration)) {
+        return 1;
+    }
+    Buffer<float> lsc_map = calibration.lsc_map;
+    Buffer<float> wb_rgb = calibration.wb;
     Buffer<float> wb4(4);
-    Buffer<float> ccm(3,3);
-    read_metadata(path_input_metadata, wb_rgb, ccm);
+    Buffer<float> ccm = calibration.ccm;
     transform_wb(input.cfa_pattern, wb_rgb, wb4);
 
     Buffer<uint16_t> output(width, height, 3);
 
-    run_benchmark(numel, [&]() {
+    // halide_malloc of the runtime unless BENCHMARK_ARENA=1 (make huge_pages)
+    const bool arena_installed = env_int("BENCHMARK_ARENA", 0) != 0;
+    if(arena_installed) {
+        use_arena();
+    }
+    if(use_numa()) {
+        input.buffer = numa_place(input.buffer);
+        output = numa_place(output);
+    }
+    auto run = [&]() {
         isp(input.buffer, lsc_map, wb4, ccm, input.black_level, input.white_level, input.cfa_pattern, gamma, sigma_spatial, sigma_range, output);
-    });
+    };
+#ifdef ISA_TARGETS
+    // isp.a of make MULTI_TARGET=true
+    printf("isp target: %s\n", multi_target_variant(ISA_TARGETS, run).c_str());
+#endif
+    run_benchmark(numel, run);
+    if(arena_installed) {
+        printf("halide_malloc arena: %.1f MB, %.1f MB in huge pages\n", arena().reserved_bytes() / 1e6, arena().huge_page_bytes() / 1e6);
+    }
 
     save_image(output, path_output);
 
@@ -0,0 +1,94 @@
+#include "HalideBuffer.h"
+#include "dng_io.h"
+#include "read_metadata.hpp"
+#include "transform_wb.hpp"
+#include "halide_image_io.h"
+#include "run_benchmark.hpp"
+
+using namespace Halide::Runtime;
+using namespace Halide::Tools;
+
+#include "isp_band.h"
+
+// rows above and below a band read by the stencils of isp_band (Demosaic and BilateralDenoise)
+const int halo = 32;
+
+int main(int argc, char ** argv) {
+
+    if(argc < 8) {
+        puts("Usage: ./test_isp_band path_input path_lsc_map path_input_metadata gamma sigma_spatial sigma_range path_output_image [max_gray] [band_height]");
+        return 1;
+    }
+    const char * path_input = argv[1];
+    const char * path_lsc_map = argv[2];
+    const char * path_input_metadata = argv[3];
+    const float gamma = atof(argv[4]);
+    const float sigma_spatial = atof(argv[5]);
+    const float sigma_range = atof(argv[6]);
+    const char * path_output = argv[7];
+    float max_gray = (argc > 8) ? atof(argv[8]) : 0.f;
+    const int band_height = (argc > 9) ? atoi(argv[9]) : 256;
+
+    DngStream<uint16_t> input;
+    if(!open_dng(path_input, input)) {
+        return 1;
+    }
+    const int width = input.width;
+    const int height = input.height;
+    const int numel = width * height;
+    Calibration calibration;
+    if(!load_calibration(path_lsc_map, path_input_metadata, calibration)) {
+        return 1;
+    }
+    Buffer<float> lsc_map = calibration.lsc_map;
+    Buffer<float> wb_rgb = calibration.wb;
+    Buffer<float> wb4(4);
+    Buffer<float> ccm = calibration.ccm;
+    transform_wb(input.raw.cfa_pattern, wb_rgb, wb4);
+
+    Buffer<uint16_t> output(width, height, 3);
+    Buffer<float> max_gray_band = Buffer<float>::make_scalar();
+    float max_gray_next = 0.f;
+    std::chrono::high_resolution_clock::time_point first_band;
+    int bands = 0;
+
+    auto run = [&](float max_gray) {
+        max_gray_next = 0.f;
+        bands = 0;
+        return stream_dng<uint16_t>(input, band_height, halo, [&](Raw<uint16_t> &band, int y, int rows) {
+            Buffer<uint16_t> output_band = output.cropped(1, y, rows);
+            isp_band(band.buffer, lsc_map, wb4, ccm, band.black_level, band.white_level, band.cfa_pattern,
+                gamma, sigma_spatial, sigma_range, max_gray, height, output_band, max_gray_band);
+            max_gray_next = std::max(max_gray_next, max_gray_band());
+            if(bands++ == 0) {
+                first_band = std::chrono::high_resolution_clock::now();
+            }
+        });
+    };
+
+    // Without a statistic from a previous frame, a first run gives the one of the preview
+    if(max_gray <= 0.f) {
+        if(!run(1.f)) {
+            return 1;
+        }
+        max_gray = max_gray_next;
+    }
+    printf("max gray: %f\n", max_gray);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    run(max_gray);
+    printf("time to the first band: %lf ms (%d bands)\n",
+        std::chrono::duration<double, std::milli>(first_band - start).count(), bands);
+    if(input.tile_length > 0) {
+        const int rows = (std::max(band_height, halo) + input.tile_length - 1) / input.tile_length * input.tile_length + 2*halo;
+        printf("raw image in memory: %d rows of %d\n", 3 * rows, height);
+    }
+
+    run_benchmark(numel, [&]() {
+        run(max_gray);
+    });
+
+    save_image(output, path_output);
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include "HalideBuffer.h"
+#include "dng_io.h"
+#include "read_metadata.hpp"
+#include "transform_wb.hpp"
+#include "halide_image_io.h"
+#include "run_benchmark.hpp"
+
+using namespace Halide::Runtime;
+using namespace Halide::Tools;
+
+#include "isp_batch.h"
+
+int main(int argc, char ** argv) {
+
+    if(argc < 8) {
+        puts("Usage: ./test_isp_batch path_input path_lsc_map path_input_metadata gamma sigma_spatial sigma_range path_output_image [frames]");
+        return 1;
+    }
+    const char * path_input = argv[1];
+    const char * path_lsc_map = argv[2];
+    const char * path_input_metadata = argv[3];
+    const float gamma = atof(argv[4]);
+    const float sigma_spatial = atof(argv[5]);
+    const float sigma_range = atof(argv[6]);
+    const char * path_output = argv[7];
+    const int frames = (argc > 8) ? atoi(argv[8]) : 8;
+
+    Raw<uint16_t> input = load_dng<uint16_t>(path_input);
+    const int width = input.buffer.width();
+    const int height = input.buffer.height();
+    const int numel = input.buffer.number_of_elements();
+    Calibration calibration;
+    if(!load_calibration(path_lsc_map, path_input_metadata, calibration)) {
+        return 1;
+    }
+    Buffer<float> lsc_map = calibration.lsc_map;
+    Buffer<float> wb_rgb = calibration.wb;
+    Buffer<float> wb4(4);
+    Buffer<float> ccm = calibration.ccm;
+    transform_wb(input.cfa_pattern, wb_rgb, wb4);
+
+    // burst of the same frame
+    Buffer<uint16_t> input_batch(width, height, frames);
+    for(int f = 0; f < frames; f++) {
+        input_batch.sliced(2, f).copy_from(input.buffer);
+    }
+
+    Buffer<uint16_t> output(width, height, 3, frames);
+
+    run_benchmark(numel*frames, [&]() {
+        isp_batch(input_batch, lsc_map, wb4, ccm, input.black_level, input.white_level, input.cfa_pattern, gamma, sigma_spatial, sigma_range, output);
+    });
+
+    save_image(output.sliced(3, 0), path_output);
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include "HalideBuffer.h"
+#include "dng_io.h"
+#include "read_metadata.hpp"
+#include "transform_wb.hpp"
+#include "halide_image_io.h"
+#include "run_benchmark.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace Halide::Runtime;
+using namespace Halide::Tools;
+
+#include "isp.h"
+#include "isp_cfa.hpp"
+
+int main(int argc, char ** argv) {
+
+    if(argc < 8) {
+        puts("Usage: ./test_isp_cfa path_input path_lsc_map path_input_metadata gamma sigma_spatial sigma_range path_output_image");
+        return 1;
+    }
+    const char * path_input = argv[1];
+    const char * path_lsc_map = argv[2];
+    const char * path_input_metadata = argv[3];
+    const float gamma = atof(argv[4]);
+    const float sigma_spatial = atof(argv[5]);
+    const float sigma_range = atof(argv[6]);
+    const char * path_output = argv[7];
+
+    Raw<uint16_t> input = load_dng<uint16_t>(path_input);
+    const int width = input.buffer.width();
+    const int height = input.buffer.height();
+    const int numel = input.buffer.number_of_elements();
+    Calibration calibration;
+    if(!load_calibration(path_lsc_map, path_input_metadata, calibration)) {
+        return 1;
+    }
+    Buffer<float> lsc_map = calibration.lsc_map;
+    Buffer<float> wb_rgb = calibration.wb;
+    Buffer<float> wb4(4);
+    Buffer<float> ccm = calibration.ccm;
+    transform_wb(input.cfa_pattern, wb_rgb, wb4);
+
+    Buffer<uint16_t> output_runtime(width, height, 3);
+    Buffer<uint16_t> output(width, height, 3);
+
+    puts("cfa_pattern at run time:");
+    run_benchmark(numel, [&]() {
+        isp(input.buffer, lsc_map, wb4, ccm, input.black_level, input.white_level, input.cfa_pattern, gamma, sigma_spatial, sigma_range, output_runtime);
+    });
+    puts("cfa_pattern at compile time:");
+    if(isp_cfa(input.buffer, lsc_map, wb4, ccm, input.black_level, input.white_level, input.cfa_pattern, gamma, sigma_spatial, sigma_range, output) != 0) {
+        printf("no isp for the CFA pattern %d\n", input.cfa_pattern);
+        return 1;
+    }
+    run_benchmark(numel, [&]() {
+        isp_cfa(input.buffer, lsc_map, wb4, ccm, input.black_level, input.white_level, input.cfa_pattern, gamma, sigma_spatial, sigma_range, output);
+    });
+
+    int max_diff = 0;
+    output.for_each_value([&](uint16_t a, uint16_t b) {
+        max_diff = std::max(max_diff, std::abs(int(a) - int(b)));
+    }, output_runtime);
+    printf("max difference: %d\n", max_diff);
+
+    save_image(output, path_output);
+
+    // the pattern only selects the code path: the outputs must be identical
+    return max_diff ? 1 : 0;
+}
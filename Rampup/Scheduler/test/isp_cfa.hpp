@@ -0,0 +1,28 @@
+#ifndef __ISP_CFA__
+#define __ISP_CFA__
+
+#include "CFA.hpp"
+#include "isp_rggb.h"
+#include "isp_grbg.h"
+#include "isp_bggr.h"
+#include "isp_gbrg.h"
+
+namespace {
+
+    // Same signature as isp: calls the isp compiled with cfa=<pattern> for cfa_pattern (make TEST=isp_cfa),
+    // -1 when there is none
+    int isp_cfa(halide_buffer_t * input, halide_buffer_t * lsc_map, halide_buffer_t * wb, halide_buffer_t * ccm,
+                halide_buffer_t * black_level, uint16_t white_level, uint8_t cfa_pattern, float gamma,
+                float sigma_spatial, float sigma_range, halide_buffer_t * output) {
+        switch (cfa_pattern) {
+        case RGGB: return isp_rggb(input, lsc_map, wb, ccm, black_level, white_level, cfa_pattern, gamma, sigma_spatial, sigma_range, output);
+        case GRBG: return isp_grbg(input, lsc_map, wb, ccm, black_level, white_level, cfa_pattern, gamma, sigma_spatial, sigma_range, output);
+        case BGGR: return isp_bggr(input, lsc_map, wb, ccm, black_level, white_level, cfa_pattern, gamma, sigma_spatial, sigma_range, output);
+        case GBRG: return isp_gbrg(input, lsc_map, wb, ccm, black_level, white_level, cfa_pattern, gamma, sigma_spatial, sigma_range, output);
+        default: return -1;
+        }
+    }
+
+};
+
+#endif
@@ -0,0 +1,72 @@
+#include "HalideBuffer.h"
+#include "dng_io.h"
+#include "read_metadata.hpp"
+#include "transform_wb.hpp"
+#include "halide_image_io.h"
+#include "run_benchmark.hpp"
+
+#include <cmath>
+
+using namespace Halide::Runtime;
+using namespace Halide::Tools;
+
+#include "isp.h"
+#include "isp_int.h"
+
+// Error bound of int_mode: the PSNR of the output of isp_int against the one of the float isp, i.e. an RMS
+// error below 1% of the range
+const double min_psnr = 40.0; // dB
+
+int main(int argc, char ** argv) {
+
+    if(argc < 8) {
+        puts("Usage: ./test_isp_int path_input path_lsc_map path_input_metadata gamma sigma_spatial sigma_range path_output_image");
+        return 1;
+    }
+    const char * path_input = argv[1];
+    const char * path_lsc_map = argv[2];
+    const char * path_input_metadata = argv[3];
+    const float gamma = atof(argv[4]);
+    const float sigma_spatial = atof(argv[5]);
+    const float sigma_range = atof(argv[6]);
+    const char * path_output = argv[7];
+
+    Raw<uint16_t> input = load_dng<uint16_t>(path_input);
+    const int width = input.buffer.width();
+    const int height = input.buffer.height();
+    const int numel = input.buffer.number_of_elements();
+    Calibration calibration;
+    if(!load_calibration(path_lsc_map, path_input_metadata, calibration)) {
+        return 1;
+    }
+    Buffer<float> lsc_map = calibration.lsc_map;
+    Buffer<float> wb_rgb = calibration.wb;
+    Buffer<float> wb4(4);
+    Buffer<float> ccm = calibration.ccm;
+    transform_wb(input.cfa_pattern, wb_rgb, wb4);
+
+    Buffer<uint16_t> output_float(width, height, 3);
+    Buffer<uint16_t> output(width, height, 3);
+
+    puts("float:");
+    run_benchmark(numel, [&]() {
+        isp(input.buffer, lsc_map, wb4, ccm, input.black_level, input.white_level, input.cfa_pattern, gamma, sigma_spatial, sigma_range, output_float);
+    });
+    puts("int:");
+    run_benchmark(numel, [&]() {
+        isp_int(input.buffer, lsc_map, wb4, ccm, input.black_level, input.white_level, input.cfa_pattern, gamma, sigma_spatial, sigma_range, output);
+    });
+
+    double mse = 0.0;
+    output.for_each_value([&](uint16_t a, uint16_t b) {
+        const double diff = double(a) - double(b);
+        mse += diff * diff;
+    }, output_float);
+    mse /= output.number_of_elements();
+    const double psnr = (mse > 0.0) ? 10.0 * log10(65535.0 * 65535.0 / mse) : INFINITY;
+    printf("PSNR int vs float: %.2f dB (min %.2f dB)\n", psnr, min_psnr);
+
+    save_image(output, path_output);
+
+    return (psnr >= min_psnr) ? 0 : 1;
+}
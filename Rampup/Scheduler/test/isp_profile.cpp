@@ -0,0 +1,59 @@
+#include "HalideBuffer.h"
+#include "dng_io.h"
+#include "read_metadata.hpp"
+#include "transform_wb.hpp"
+#include "halide_image_io.h"
+#include "run_benchmark.hpp"
+#include "profile.hpp"
+
+#include <string>
+
+using namespace Halide::Runtime;
+using namespace Halide::Tools;
+
+#include "isp.h"
+
+int main(int argc, char ** argv) {
+
+    if(argc < 8) {
+        puts("Usage: ./test_isp_profile path_input path_lsc_map path_input_metadata gamma sigma_spatial sigma_range path_output_image [path_profile]");
+        return 1;
+    }
+    const char * path_input = argv[1];
+    const char * path_lsc_map = argv[2];
+    const char * path_input_metadata = argv[3];
+    const float gamma = atof(argv[4]);
+    const float sigma_spatial = atof(argv[5]);
+    const float sigma_range = atof(argv[6]);
+    const char * path_output = argv[7];
+    // one JSON line per run is appended to path_profile (path_output.json by default)
+    const std::string path_profile = (argc > 8) ? argv[8] : std::string(path_output) + ".json";
+
+    Raw<uint16_t> input = load_dng<uint16_t>(path_input);
+    const int width = input.buffer.width();
+    const int height = input.buffer.height();
+    const int numel = input.buffer.number_of_elements();
+    Calibration calibration;
+    if(!load_calibration(path_lsc_map, path_input_metadata, calibration)) {
+        return 1;
+    }
+    Buffer<float> lsc_map = calibration.lsc_map;
+    Buffer<float> wb_rgb = calibration.wb;
+    Buffer<float> wb4(4);
+    Buffer<float> ccm = calibration.ccm;
+    transform_wb(input.cfa_pattern, wb_rgb, wb4);
+
+    Buffer<uint16_t> output(width, height, 3);
+
+    profile_path = path_profile.c_str();
+    profile_run = path_input;
+    halide_profiler_reset();
+    run_benchmark(numel, [&]() {
+        isp(input.buffer, lsc_map, wb4, ccm, input.black_level, input.white_level, input.cfa_pattern, gamma, sigma_spatial, sigma_range, output);
+    });
+    halide_profiler_report(nullptr);
+
+    save_image(output, path_output);
+
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include "HalideBuffer.h"
+#include "dng_io.h"
+#include "run_benchmark.hpp"
+
+#include <sys/stat.h>
+
+using namespace Halide::Runtime;
+
+// Decoding throughput of load_dng (lj92 for the lossless JPEG DNGs) in MB/s of the file and of the
+// decoded pixels, with the same arguments as the other harnesses so that it runs with make test.
+int main(int argc, char ** argv) {
+
+    if(argc < 2) {
+        puts("Usage: ./test_load_dng path_input [...]");
+        return 1;
+    }
+    const char * path_input = argv[1];
+    const bool halide_thread_pool = getenv("LOAD_DNG_SERIAL") == nullptr;
+
+    struct stat st;
+    if(stat(path_input, &st) != 0) {
+        printf("could not stat %s\n", path_input);
+        return 1;
+    }
+
+    Raw<uint16_t> input = load_dng<uint16_t>(path_input, halide_thread_pool);
+    const int numel = input.buffer.number_of_elements();
+
+    const double time = run_benchmark(numel, [&]() {
+        Raw<uint16_t> raw = load_dng<uint16_t>(path_input, halide_thread_pool);
+    });
+
+    printf("file %lf MB/s decoded %lf MB/s\n", st.st_size / (time * 1e3), numel * sizeof(uint16_t) / (time * 1e3));
+
+    return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef __MULTI_TARGET__
+#define __MULTI_TARGET__
+
+#include "HalideRuntime.h"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+    // Which target of a multi-target pipeline runs on the host. The wrapper of a pipeline compiled for
+    // target=a,b,...,z asks halide_can_use_target_features about a, b, ... in order and calls the first one
+    // that the host supports, the last one (the baseline) when none is. The queries of a call are counted
+    // to name it.
+    struct MultiTargetProbe {
+        int queries = 0;
+        int chosen = -1; // index of the first target supported, -1: none
+    };
+
+    MultiTargetProbe multi_target_probe;
+
+    int probe_can_use_target_features(int count, const uint64_t * features) {
+        const int result = halide_default_can_use_target_features(count, features);
+        if(result && (multi_target_probe.chosen < 0)) {
+            multi_target_probe.chosen = multi_target_probe.queries;
+        }
+        multi_target_probe.queries++;
+        return result;
+    }
+
+    // Target of targets (the comma separated target= of the pipeline) that the pipeline call run uses
+    template<typename F>
+    std::string multi_target_variant(const std::string & targets, F run) {
+        std::vector<std::string> names;
+        std::stringstream ss(targets);
+        std::string name;
+        while(std::getline(ss, name, ',')) {
+            names.push_back(name);
+        }
+
+        multi_target_probe = MultiTargetProbe();
+        halide_can_use_target_features_t previous = halide_set_custom_can_use_target_features(probe_can_use_target_features);
+        run();
+        halide_set_custom_can_use_target_features(previous);
+
+        const int chosen = multi_target_probe.chosen;
+        if(names.empty()) {
+            return "";
+        }
+        return ((chosen >= 0) && (chosen < int(names.size()))) ? names[chosen] : names.back();
+    }
+};
+
+#endif
@@ -0,0 +1,231 @@
+#ifndef __NUMA__
+#define __NUMA__
+
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace {
+    using namespace Halide::Runtime;
+
+    // CPUs of each NUMA node from sysfs, a single node with all the CPUs without it
+    std::vector<std::vector<int>> numa_nodes() {
+        std::vector<std::vector<int>> nodes;
+        for(int n = 0; ; n++) {
+            char path[64];
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", n);
+            FILE * f = fopen(path, "r");
+            if(f == nullptr) {
+                break;
+            }
+            std::vector<int> cpus;
+            int first, last;
+            while(fscanf(f, "%d", &first) == 1) { // e.g. 0-15,32-47
+                last = first;
+                int sep = fgetc(f);
+                if((sep == '-') && (fscanf(f, "%d", &last) == 1)) {
+                    sep = fgetc(f);
+                }
+                for(int cpu = first; cpu <= last; cpu++) {
+                    cpus.push_back(cpu);
+                }
+                if(sep != ',') {
+                    break;
+                }
+            }
+            fclose(f);
+            if(!cpus.empty()) {
+                nodes.push_back(cpus);
+            }
+        }
+        if(nodes.empty()) {
+            nodes.emplace_back();
+            for(int cpu = 0; cpu < int(std::thread::hardware_concurrency()); cpu++) {
+                nodes.back().push_back(cpu);
+            }
+        }
+        return nodes;
+    }
+
+    // halide_do_par_for with one worker pinned to each CPU of the nodes. The tasks of a loop are cut into
+    // one contiguous range per node, in order, so that a parallel loop over rows (or bands of rows) gives
+    // the k-th band of the image to the k-th node: the pages of the buffers that the loop writes first are
+    // placed on the node that computes them (first touch), and the next loops over the same rows find them
+    // there. A worker runs the tasks of its node first, then steals from the other nodes. The loops nested
+    // in a task run serially in the worker.
+    class NumaPool {
+    public:
+        explicit NumaPool(const std::vector<std::vector<int>> & nodes) : ranges(nodes.size()) {
+            for(size_t node = 0; node < nodes.size(); node++) {
+                for(int cpu : nodes[node]) {
+                    std::thread(&NumaPool::worker, this, int(node), cpu).detach();
+                    num_workers++;
+                }
+            }
+        }
+
+        int par_for(void * user_context, halide_task_t f, int min, int size, uint8_t * closure) {
+            if(is_worker() || (size <= 1)) {
+                for(int i = min; i < min + size; i++) {
+                    const int result = f(user_context, i, closure);
+                    if(result != 0) {
+                        return result;
+                    }
+                }
+                return 0;
+            }
+
+            std::lock_guard<std::mutex> loop_lock(loop_mutex); // one loop at a time
+            std::unique_lock<std::mutex> lock(mutex);
+            idle.wait(lock, [&]() { return active == 0; }); // no worker left in the ranges of the last loop
+            job = {user_context, f, closure};
+            const int num_nodes = ranges.size();
+            for(int node = 0; node < num_nodes; node++) {
+                ranges[node].next = min + int(int64_t(size) * node / num_nodes);
+                ranges[node].end = min + int(int64_t(size) * (node + 1) / num_nodes);
+            }
+            remaining = size;
+            result = 0;
+            generation++;
+            wake.notify_all();
+            idle.wait(lock, [&]() { return remaining == 0; });
+            return result;
+        }
+
+        int nodes() const {
+            return ranges.size();
+        }
+
+        int workers() const {
+            return num_workers;
+        }
+
+    private:
+        struct Job {
+            void * user_context;
+            halide_task_t f;
+            uint8_t * closure;
+        };
+        struct Range {
+            std::atomic<int> next{0};
+            int end = 0;
+        };
+
+        static bool & is_worker() {
+            static thread_local bool worker = false;
+            return worker;
+        }
+
+        void worker(int node, int cpu) {
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            sched_setaffinity(0, sizeof(set), &set);
+#endif
+            is_worker() = true;
+            uint64_t seen = 0;
+            for(;;) {
+                Job current;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [&]() { return generation != seen; });
+                    seen = generation;
+                    current = job;
+                    active++;
+                }
+                int done = 0;
+                int error = 0;
+                const int num_nodes = ranges.size();
+                for(int i = 0; i < num_nodes; i++) {
+                    Range & range = ranges[(node + i) % num_nodes];
+                    for(int task = range.next++; task < range.end; task = range.next++) {
+                        const int r = current.f(current.user_context, task, current.closure);
+                        if((r != 0) && (error == 0)) {
+                            error = r;
+                        }
+                        done++;
+                    }
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                if((error != 0) && (result == 0)) {
+                    result = error;
+                }
+                remaining -= done;
+                active--;
+                if((remaining == 0) || (active == 0)) {
+                    idle.notify_all();
+                }
+            }
+        }
+
+        std::vector<Range> ranges;
+        int num_workers = 0;
+        std::mutex loop_mutex;
+        std::mutex mutex;
+        std::condition_variable wake, idle;
+        Job job{};
+        uint64_t generation = 0;
+        int remaining = 0;
+        int active = 0;
+        int result = 0;
+    };
+
+    // never destroyed, the workers are detached
+    NumaPool * numa_pool = nullptr;
+
+    int numa_do_par_for(void * user_context, halide_task_t f, int min, int size, uint8_t * closure) {
+        return numa_pool->par_for(user_context, f, min, size, closure);
+    }
+
+    // halide_do_par_for on a NumaPool of the first BENCHMARK_NUMA nodes (0, by default, for the thread pool
+    // of the Halide runtime). Returns whether it is installed.
+    bool use_numa() {
+        const char * numa = getenv("BENCHMARK_NUMA");
+        const int num_nodes = (numa && *numa) ? atoi(numa) : 0;
+        if(num_nodes <= 0) {
+            return false;
+        }
+        if(numa_pool == nullptr) {
+            std::vector<std::vector<int>> nodes = numa_nodes();
+            if(num_nodes < int(nodes.size())) {
+                nodes.resize(num_nodes);
+            }
+            numa_pool = new NumaPool(nodes);
+            printf("NUMA: %d nodes, %d workers\n", numa_pool->nodes(), numa_pool->workers());
+        }
+        halide_set_custom_do_par_for(numa_do_par_for);
+        return true;
+    }
+
+    // Copy of buffer whose rows (dimension 1) are first touched in a parallel loop over them, so that each
+    // node of numa_pool holds the pages of its band of rows
+    template<typename T>
+    Buffer<T> numa_place(const Buffer<T> & buffer) {
+        Buffer<T> placed = Buffer<T>::make_with_shape_of(buffer);
+        struct Closure {
+            const Buffer<T> * src;
+            Buffer<T> * dst;
+        } closure{&buffer, &placed};
+        halide_do_par_for(nullptr, [](void *, int y, uint8_t * c) -> int {
+            Closure * closure = reinterpret_cast<Closure *>(c);
+            closure->dst->sliced(1, y).copy_from(closure->src->sliced(1, y));
+            return 0;
+        }, buffer.dim(1).min(), buffer.dim(1).extent(), reinterpret_cast<uint8_t *>(&closure));
+        return placed;
+    }
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef __PROFILE__
+#define __PROFILE__
+
+#include "HalideRuntime.h"
+#include "run_benchmark.hpp" // print_json_string
+
+#include <cstdio>
+
+namespace {
+    const char * profile_path = nullptr;
+    const char * profile_run = "";
+}
+
+// Replaces the (weak) halide_profiler_report of the runtime: instead of printing the report, it appends
+// a JSON line to profile_path with the time and memory peaks of every pipeline and Func profiled since
+// the last report, and resets the profiler, so that every call is the report of one run.
+// The pipelines have to be compiled with the profile feature (e.g. target=host-profile).
+extern "C" void halide_profiler_report(void *user_context) {
+    halide_profiler_state *state = halide_profiler_get_state();
+    FILE *file = profile_path ? fopen(profile_path, "a") : nullptr;
+    if(file == nullptr) {
+        return;
+    }
+
+    halide_mutex_lock(&state->lock);
+    fprintf(file, "{\"run\": ");
+    print_json_string(file, profile_run);
+    fprintf(file, ", \"pipelines\": [");
+    for(halide_profiler_pipeline_stats *p = state->pipelines; p; p = (halide_profiler_pipeline_stats *)p->next) {
+        const int runs = (p->runs > 0) ? p->runs : 1;
+        fprintf(file, "{\"name\": ");
+        print_json_string(file, p->name);
+        fprintf(file, ", \"runs\": %d, \"time_ms\": %lf, \"memory_peak\": %llu, \"funcs\": [",
+            p->runs, p->time / (runs * 1e6), (unsigned long long)p->memory_peak);
+        for(int i = 0; i < p->num_funcs; i++) {
+            const halide_profiler_func_stats &f = p->funcs[i];
+            fprintf(file, "%s{\"name\": ", (i > 0) ? ", " : "");
+            print_json_string(file, f.name);
+            fprintf(file, ", \"time_ms\": %lf, \"memory_peak\": %llu, \"stack_peak\": %llu, \"num_allocs\": %llu}",
+                f.time / (runs * 1e6), (unsigned long long)f.memory_peak,
+                (unsigned long long)f.stack_peak, (unsigned long long)f.num_allocs);
+        }
+        fprintf(file, "]}%s", p->next ? ", " : "");
+    }
+    fprintf(file, "]}\n");
+    halide_mutex_unlock(&state->lock);
+    fclose(file);
+
+    halide_profiler_reset();
+}
+
+#endif
@@ -0,0 +1,100 @@
+// Benchmark of every scheduler of one stage (make sweep SWEEP_STAGE=<stage> SWEEP="<schedulers>"):
+// the variants are compiled from the same generator with -f <stage>_<scheduler>, and bin/sweep_variants.h
+// (generated by the Makefile) includes their headers and lists them in SWEEP_VARIANTS.
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sweep_variants.h"
+
+#define SWEEP
+#define SWEEP_STR(s) #s
+#define SWEEP_NAME(s) SWEEP_STR(s)
+
+namespace {
+    struct SweepVariant {
+        const char * name;
+        int scheduler;
+        void * function;
+    };
+
+#define SWEEP_VARIANT(function, scheduler) {#function, scheduler, (void *)&function},
+    const SweepVariant sweep_variants[] = { SWEEP_VARIANTS };
+#undef SWEEP_VARIANT
+
+    void * sweep_function = nullptr;
+}
+
+// the function of the variant being benchmarked instead of the one of SWEEP_STAGE
+template<typename F>
+F sweep_select(F function) {
+    if(sweep_function && ((void *)function == (void *)&SWEEP_STAGE)) {
+        return (F)sweep_function;
+    }
+    return function;
+}
+
+#include "test.hpp"
+
+typedef int (*TestFunction)(int, char **, double *);
+
+TestFunction test_function(const char * stage) {
+    const std::pair<const char *, TestFunction> tests[] = {
+        {"bilateral_denoise", test<BD>},
+        {"bilinear_resize", test<BR>},
+        {"black_level_subtraction", test<BLS>},
+        {"color_correction", test<CC>},
+        {"demosaic", test<DMS>},
+        {"denormalization", test<DNORM>},
+        {"gamma_correction", test<GC>},
+        {"guided_filter", test<GF>},
+        {"lens_shading_correction", test<LSC>},
+        {"mix", test<MIX>},
+        {"normalization", test<NORM>},
+        {"reinhard_tone_mapping", test<RTM>},
+        {"rgb_to_ycbcr", test<R2Y>},
+        {"white_balance", test<WB>},
+        {"ycbcr_to_rgb", test<Y2R>},
+    };
+    for(const auto &t : tests) {
+        if(strcmp(t.first, stage) == 0) {
+            return t.second;
+        }
+    }
+    return nullptr;
+}
+
+int main(int argc, char ** argv) {
+    TestFunction test_stage = test_function(SWEEP_NAME(SWEEP_STAGE));
+    if(test_stage == nullptr) {
+        printf("No test for %s\n", SWEEP_NAME(SWEEP_STAGE));
+        return 1;
+    }
+
+    // the label of the lines of BENCHMARK_OUTPUT is <label>:<scheduler>
+    const std::string label = getenv("BENCHMARK_LABEL") ? getenv("BENCHMARK_LABEL") : "";
+    std::vector<std::pair<double, const SweepVariant *>> ranking;
+    for(const SweepVariant &variant : sweep_variants) {
+        printf("%s\n", variant.name);
+        sweep_function = variant.function;
+        setenv("BENCHMARK_LABEL", (label + ":" + std::to_string(variant.scheduler)).c_str(), 1);
+        double time = 0.0;
+        const int ret = test_stage(argc, argv, &time);
+        if(ret != 0) {
+            return ret;
+        }
+        ranking.push_back({time, &variant});
+    }
+
+    std::sort(ranking.begin(), ranking.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+    puts("ranking (median time):");
+    for(const auto &r : ranking) {
+        printf("  scheduler %d: %lf ms\n", r.second->scheduler, r.first);
+    }
+
+    return 0;
+}
@@ -7,6 +7,7 @@
 #include "transform_wb.hpp"
 #include "halide_image_io.h"
 #include "run_benchmark.hpp"
+#include "arena.hpp"
 
 using namespace Halide::Runtime;
 using namespace Halide::Tools;
@@ -23,9 +24,19 @@ using namespace Halide::Tools;
 #include "denormalization.h"
 #include "rgb_to_ycbcr.h"
 #include "bilateral_denoise.h"
+#include "guided_filter.h"
 #include "mix.h"
 #include "ycbcr_to_rgb.h"
 
+#ifndef SWEEP
+// The stage functions are called through sweep_select, so that test/sweep.cpp can replace the
+// function of the stage under test by a variant compiled with another scheduler
+template<typename F>
+F sweep_select(F function) {
+    return function;
+}
+#endif
+
 enum Test {
     BD = 0,
     BR,
@@ -34,6 +45,7 @@ enum Test {
     DMS,
     DNORM,
     GC,
+    GF,
     LSC,
     MIX,
     NORM,
@@ -43,8 +55,9 @@ enum Test {
     Y2R,
 };
 
+// time (median in ms) of the stage under test in *time if it is not null
 template<Test OP>
-int test(int argc, char ** argv) {
+int test(int argc, char ** argv, double * time = nullptr) {
     if(argc < 8) {
         puts("Usage: ./test_* path_input path_lsc_map path_input_metadata gamma sigma_spatial sigma_range path_output_image");
         return 1;
@@ -61,85 +74,97 @@ int test(int argc, char ** argv) {
     const int width = input.buffer.width();
     const int height = input.buffer.height();
     const int numel = input.buffer.number_of_elements();
-    Buffer<float> lsc_map = load_image(path_lsc_map);
-    Buffer<float> wb_rgb(3);
+    Calibration calibration;
+    if(!load_calibration(path_lsc_map, path_input_metadata, calibration)) {
+        return 1;
+    }
+    Buffer<float> lsc_map = calibration.lsc_map;
+    Buffer<float> wb_rgb = calibration.wb;
     Buffer<float> wb4(4);
-    Buffer<float> ccm(3,3);
-    read_metadata(path_input_metadata, wb_rgb, ccm);
+    Buffer<float> ccm = calibration.ccm;
     transform_wb(input.cfa_pattern, wb_rgb, wb4);
 
     Buffer<uint16_t> output(width, height, 3);
+    double op_time = 0.0;
+    use_arena();
 
     {
+        // The stages ping-pong between the planes of ping and pong: the output of a stage goes to the one
+        // that its inputs are not in. im_dns (read with im_r2y and im_dms) has its own planes.
+        Buffer<float> ping(width, height, 3);
+        Buffer<float> pong(width, height, 3);
+        Buffer<float> ping_plane = ping.sliced(2, 0);
+        Buffer<float> pong_plane = pong.sliced(2, 0);
+
         Buffer<float> black_level_f32(4);
         for(int i=0; i<4; ++i) black_level_f32(i) = float(input.black_level(i)) / input.white_level;
 
-        Buffer<float> im_norm(width, height);
+        Buffer<float> & im_norm = ping_plane;
         auto norm = [&]() {
-            normalization(input.buffer, input.white_level, im_norm);
+            sweep_select(normalization)(input.buffer, input.white_level, im_norm);
         };
         if(OP == NORM) {
-            run_benchmark(numel, norm);
+            op_time = run_benchmark(numel, norm);
         } else {
             norm();
         }
 
-        Buffer<float> im_bls(width, height);
+        Buffer<float> & im_bls = pong_plane;
         auto bls = [&]() {
-            black_level_subtraction(im_norm, black_level_f32, im_bls);
+            sweep_select(black_level_subtraction)(im_norm, black_level_f32, im_bls);
         };
         if(OP == BLS) {
-            run_benchmark(numel, bls);
+            op_time = run_benchmark(numel, bls);
         } else {
             bls();
         }
 
         Buffer<float> lsc_map_bigger(width/2, height/2, 4);
         auto br = [&]() {
-            bilinear_resize(lsc_map, lsc_map.width(), lsc_map.height(), width/2, height/2, lsc_map_bigger);
+            sweep_select(bilinear_resize)(lsc_map, lsc_map.width(), lsc_map.height(), width/2, height/2, lsc_map_bigger);
         };
         if(OP == BR) {
-            run_benchmark(numel, br);
+            op_time = run_benchmark(numel, br);
         } else {
             br();
         }
 
-        Buffer<float> im_lsc(width, height);
+        Buffer<float> & im_lsc = ping_plane;
         auto lsc = [&]() {
-            lens_shading_correction(im_bls, lsc_map_bigger, im_lsc);
+            sweep_select(lens_shading_correction)(im_bls, lsc_map_bigger, im_lsc);
         };
         if(OP == LSC) {
-            run_benchmark(numel, lsc);
+            op_time = run_benchmark(numel, lsc);
         } else {
             lsc();
         }
 
-        Buffer<float> im_wb(width, height);
+        Buffer<float> & im_wb = pong_plane;
         auto wb = [&]() {
-            white_balance(im_lsc, wb4, im_wb);
+            sweep_select(white_balance)(im_lsc, wb4, im_wb);
         };
         if(OP == WB) {
-            run_benchmark(numel, wb);
+            op_time = run_benchmark(numel, wb);
         } else {
             wb();
         }
 
-        Buffer<float> im_dms(width, height, 3);
+        Buffer<float> & im_dms = ping;
         auto dms = [&]() {
-            demosaic(im_wb, width, height, input.cfa_pattern, im_dms);
+            sweep_select(demosaic)(im_wb, width, height, input.cfa_pattern, im_dms);
         };
         if(OP == DMS) {
-            run_benchmark(numel, dms);
+            op_time = run_benchmark(numel, dms);
         } else {
             dms();
         }
 
-        Buffer<float> im_r2y(width, height, 3);
+        Buffer<float> & im_r2y = pong;
         auto r2y = [&]() {
-            rgb_to_ycbcr(im_dms, im_r2y);
+            sweep_select(rgb_to_ycbcr)(im_dms, im_r2y);
         };
         if(OP == R2Y) {
-            run_benchmark(numel, r2y);
+            op_time = run_benchmark(numel, r2y);
         } else {
             r2y();
         }
@@ -147,75 +172,83 @@ int test(int argc, char ** argv) {
         Buffer<float> im_dns(width, height, 2);
         im_dns.set_min({0, 0, 1});
         auto bd = [&]() {
-            bilateral_denoise(im_r2y, im_dms, width, height, sigma_spatial, sigma_range, im_dns);
+            if(OP == GF) {
+                sweep_select(guided_filter)(im_r2y, width, height, sigma_spatial, sigma_range, im_dns);
+            } else {
+                sweep_select(bilateral_denoise)(im_r2y, im_dms, width, height, sigma_spatial, sigma_range, im_dns);
+            }
         };
-        if(OP == BD) {
-            run_benchmark(numel, bd);
+        if((OP == BD) || (OP == GF)) {
+            op_time = run_benchmark(numel, bd);
         } else {
             bd();
         }
 
-        Buffer<float> im_mix(width, height, 3);
+        Buffer<float> & im_mix = ping;
         auto lmix = [&]() {
-            mix(im_r2y, im_dns, im_mix);
+            sweep_select(mix)(im_r2y, im_dns, im_mix);
         };
         if(OP == MIX) {
-            run_benchmark(numel, lmix);
+            op_time = run_benchmark(numel, lmix);
         } else {
             lmix();
         }
 
-        Buffer<float> im_y2r(width, height, 3);
+        Buffer<float> & im_y2r = pong;
         auto y2r = [&]() {
-            ycbcr_to_rgb(im_mix, im_y2r);
+            sweep_select(ycbcr_to_rgb)(im_mix, im_y2r);
         };
         if(OP == Y2R) {
-            run_benchmark(numel, y2r);
+            op_time = run_benchmark(numel, y2r);
         } else {
             y2r();
         }
 
-        Buffer<float> im_cc(width, height, 3);
+        Buffer<float> & im_cc = ping;
         auto cc = [&]() {
-            color_correction(im_y2r, ccm, im_cc);
+            sweep_select(color_correction)(im_y2r, ccm, im_cc);
         };
         if(OP == CC) {
-            run_benchmark(numel, cc);
+            op_time = run_benchmark(numel, cc);
         } else {
             cc();
         }
 
-        Buffer<float> im_tm(width, height, 3);
+        Buffer<float> & im_tm = pong;
         auto rtm = [&]() {
-            reinhard_tone_mapping(im_cc, width, height, im_tm);
+            sweep_select(reinhard_tone_mapping)(im_cc, width, height, im_tm);
         };
         if(OP == RTM) {
-            run_benchmark(numel, rtm);
+            op_time = run_benchmark(numel, rtm);
         } else {
             rtm();
         }
 
-        Buffer<float> im_gc(width, height, 3);
+        Buffer<float> & im_gc = ping;
         auto gc = [&]() {
-            gamma_correction(im_tm, gamma, im_gc);
+            sweep_select(gamma_correction)(im_tm, gamma, im_gc);
         };
         if(OP == GC) {
-            run_benchmark(numel, gc);
+            op_time = run_benchmark(numel, gc);
         } else {
             gc();
         }
 
         auto dnorm = [&]() {
-            denormalization(im_gc, 65535, output);
+            sweep_select(denormalization)(im_gc, 65535, output);
         };
         if(OP == DNORM) {
-            run_benchmark(numel, dnorm);
+            op_time = run_benchmark(numel, dnorm);
         } else {
             dnorm();
         }
     }
 
+    printf("halide_malloc arena: %.1f MB, %.1f MB in huge pages\n", arena().reserved_bytes() / 1e6, arena().huge_page_bytes() / 1e6);
     save_image(output, path_output);
+    if(time) {
+        *time = op_time;
+    }
 
     return 0;
 }
@@ -0,0 +1,79 @@
+#include "HalideBuffer.h"
+#include "dng_io.h"
+#include "run_benchmark.hpp"
+
+using namespace Halide::Runtime;
+
+#include "normalization.h"
+#include "normalization_packed.h"
+
+#ifndef PACKED_BITS
+#define PACKED_BITS 10
+#endif
+
+// MIPI RAW10/12/14 bytes of the pixels of input (clamped to bits), as in halide/unpack.hpp
+Buffer<uint8_t> pack(const Buffer<uint16_t> &input, int bits) {
+    const int n = (bits == 12) ? 2 : 4;
+    const int group_bytes = n * bits / 8;
+    const int lsb_bits = bits - 8;
+    const int max_value = (1 << bits) - 1;
+    Buffer<uint8_t> packed(input.width() / n * group_bytes, input.height());
+    packed.fill(0);
+    for(int y = 0; y < input.height(); y++) {
+        for(int x = 0; x < input.width(); x++) {
+            const int v = std::min<int>(input(x, y), max_value);
+            const int base = (x / n) * group_bytes;
+            const int i = x % n;
+            packed(base + i, y) = v >> lsb_bits;
+            const int lsb = (v & ((1 << lsb_bits) - 1)) << ((i * lsb_bits) % 8);
+            const int k = base + n + (i * lsb_bits) / 8;
+            packed(k, y) |= lsb & 0xff;
+            if(lsb >> 8) {
+                packed(k + 1, y) |= lsb >> 8;
+            }
+        }
+    }
+    return packed;
+}
+
+int main(int argc, char ** argv) {
+
+    if(argc < 2) {
+        puts("Usage: ./test_unpack path_input [...]");
+        return 1;
+    }
+    const char * path_input = argv[1];
+    const int bits = PACKED_BITS;
+
+    Raw<uint16_t> raw = load_dng<uint16_t>(path_input);
+    // whole groups of pixels, values of bits bits
+    const int width = raw.buffer.width() / 4 * 4;
+    const int height = raw.buffer.height();
+    const int numel = width * height;
+    const uint16_t white_level = std::min<int>(raw.white_level, (1 << bits) - 1);
+    Buffer<uint16_t> input(width, height);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = std::min(raw.buffer(x, y), white_level);
+    });
+    Buffer<uint8_t> packed = pack(input, bits);
+
+    Buffer<float> output(width, height);
+    Buffer<float> output_packed(width, height);
+
+    printf("uint16: %d bytes\n", int(input.size_in_bytes()));
+    run_benchmark(numel, [&]() {
+        normalization(input, white_level, output);
+    });
+    printf("RAW%d: %d bytes\n", bits, int(packed.size_in_bytes()));
+    run_benchmark(numel, [&]() {
+        normalization_packed(packed, white_level, output_packed);
+    });
+
+    int errors = 0;
+    output.for_each_element([&](int x, int y) {
+        errors += (output(x, y) != output_packed(x, y));
+    });
+    printf("%d pixels differ\n", errors);
+
+    return errors ? 1 : 0;
+}
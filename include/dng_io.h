@@ -1,9 +1,25 @@
 #ifndef _DNG_IO_
 #define _DNG_IO_
 
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define DNG_IO_MMAP
+#endif
 
 #define TINY_DNG_LOADER_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -21,54 +37,162 @@ struct Raw {
     Buffer<T> black_level;
     T white_level;
     uint8_t cfa_pattern;
+    // Memory of buffer (mapping of the file or decoded image), which buffer does not own
+    std::shared_ptr<void> storage;
 };
 
+// Parallel loop of tinydng (tiles of lossless JPEG images) in the thread pool of the Halide runtime
+inline void halide_parallel_for(int n, void (*fn)(void * context, int i), void * context) {
+    struct Closure {
+        void (*fn)(void *, int);
+        void * context;
+    } closure{fn, context};
+    halide_do_par_for(nullptr, [](void *, int i, uint8_t * c) -> int {
+        Closure * closure = reinterpret_cast<Closure *>(c);
+        closure->fn(closure->context, i);
+        return 0;
+    }, 0, n, reinterpret_cast<uint8_t *>(&closure));
+}
+
+// Whole file in memory: mapped (copy on write) when mmap is available, read otherwise
+inline std::shared_ptr<unsigned char> map_file(const char * filename, size_t &size) {
+    size = 0;
+#ifdef DNG_IO_MMAP
+    const int fd = open(filename, O_RDONLY);
+    if(fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if((fstat(fd, &st) != 0) || (st.st_size <= 0)) {
+        close(fd);
+        return nullptr;
+    }
+    void * mem = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mem == MAP_FAILED) {
+        return nullptr;
+    }
+    size = st.st_size;
+    return std::shared_ptr<unsigned char>(static_cast<unsigned char *>(mem), [size](unsigned char * p) { munmap(p, size); });
+#else
+    FILE * fp = fopen(filename, "rb");
+    if(fp == nullptr) {
+        return nullptr;
+    }
+    fseek(fp, 0, SEEK_END);
+    const long file_size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    std::shared_ptr<unsigned char> mem(new unsigned char[file_size > 0 ? file_size : 1], std::default_delete<unsigned char[]>());
+    size = (file_size > 0) ? fread(mem.get(), 1, file_size, fp) : 0;
+    fclose(fp);
+    return (size > 0) ? mem : nullptr;
+#endif
+}
+
+// Offset of the pixels of an uncompressed image in the file if they can be used in place: one sample of
+// sizeof(T) bytes per pixel in the byte order of the host, not tiled, the strips one after the other and
+// aligned for T. 0 otherwise.
 template<typename T>
-Raw<T> load_dng(const char * filename) {
+size_t in_place_offset(const tinydng::DNGImage &image, bool swap_endian, size_t file_size) {
+    if((image.compression != tinydng::COMPRESSION_NONE) || (image.jpeg_byte_count > 0) || swap_endian ||
+       (image.samples_per_pixel != 1) || (image.bits_per_sample_original != 8 * int(sizeof(T))) ||
+       ((image.tile_width > 0) && (image.tile_width < image.width))) {
+        return 0;
+    }
+    const size_t offset = (image.offset > 0) ? image.offset : image.tile_offset;
+    const size_t row_size = size_t(image.width) * sizeof(T);
+    if((offset == 0) || (offset % alignof(T) != 0) || (offset + row_size * image.height > file_size)) {
+        return 0;
+    }
+    for(size_t i = 1; i < image.strip_offsets.size(); i++) {
+        if(image.strip_offsets[i] != image.strip_offsets[i - 1] + image.strip_byte_counts[i - 1]) {
+            return 0;
+        }
+    }
+    return offset;
+}
+
+// White and black levels and CFA pattern of image
+template<typename T>
+void read_dng_metadata(const tinydng::DNGImage &image, Raw<T> &raw) {
+    raw.white_level = std::max(
+        std::max(image.white_level[0], image.white_level[1]),
+        std::max(image.white_level[2], image.white_level[3])
+    );
+
+    const char first = image.cfa_plane_color[image.cfa_pattern[0][0]];
+    if(first == 0) {
+        raw.cfa_pattern = RGGB;
+    } else if(first == 1) {
+        const char second = image.cfa_plane_color[image.cfa_pattern[0][1]];
+        if(second == 0) {
+            raw.cfa_pattern = GRBG;
+        } else if(second == 2) {
+            raw.cfa_pattern = GBRG;
+        } else {
+            raw.cfa_pattern = NONE;
+        }
+    } else if(first == 2) {
+        raw.cfa_pattern = BGGR;
+    } else {
+        raw.cfa_pattern = NONE;
+    }
+
+    raw.black_level = Buffer<T>(4);
+    for(int i = 0; i < 4; ++i) {
+        raw.black_level(i) = image.black_level[i];
+    }
+}
+
+// halide_thread_pool: compressed tiles decoded in the thread pool of the Halide runtime instead of std::threads
+// (opt-in, e.g. make test TEST=load_dng, so that the pipelines timed on that pool do not share it with the decoder)
+template<typename T>
+Raw<T> load_dng(const char * filename, bool halide_thread_pool = false) {
     Raw<T> ret;
 
     std::string warn, err;
     std::vector<tinydng::DNGImage> images;
     std::vector<tinydng::FieldInfo> custom_fields;
 
-    bool read = tinydng::LoadDNG(filename, custom_fields, &images, &warn, &err);
+    size_t file_size;
+    std::shared_ptr<unsigned char> file = map_file(filename, file_size);
+    const char * mem = reinterpret_cast<const char *>(file.get());
+
+    // Uncompressed images are used in place in the mapping of the file: only the IFDs are parsed.
+    // Otherwise, the image decoded by tinydng is the memory of the buffer (no copy).
+    bool read = false;
+    size_t offset = 0;
+    if(file && (file_size >= 32)) {
+        const unsigned short magic = *reinterpret_cast<const unsigned short *>(mem);
+        const bool swap_endian = (magic == 0x4d4d) && !tinydng::IsBigEndian();
+        if((magic == 0x4949) || (magic == 0x4d4d)) {
+            tinydng::StreamReader sr(file.get(), file_size, swap_endian);
+            read = sr.seek_set(4) && tinydng::ParseDNGFromMemory(sr, custom_fields, &images, &warn, &err) &&
+                (images.size() > 0);
+            offset = read ? in_place_offset<T>(images[0], swap_endian, file_size) : 0;
+        }
+        if(offset == 0) {
+            tinydng::SetParallelFor(halide_thread_pool ? halide_parallel_for : nullptr);
+            images.clear();
+            read = tinydng::LoadDNGFromMemory(mem, static_cast<unsigned int>(file_size), custom_fields, &images, &warn, &err);
+        }
+    } else {
+        err = std::string("Cannot open file ") + filename + "\n";
+    }
 
     if(read && (images.size() > 0)) {
         const tinydng::DNGImage &image = images[0];
 
-        ret.white_level = std::max(
-            std::max(image.white_level[0], image.white_level[1]),
-            std::max(image.white_level[2], image.white_level[3])
-        );
-
-        const char first = image.cfa_plane_color[image.cfa_pattern[0][0]];
-        if(first == 0) {
-            ret.cfa_pattern = RGGB;
-        } else if(first == 1) {
-            const char second = image.cfa_plane_color[image.cfa_pattern[0][1]];
-            if(second == 0) {
-                ret.cfa_pattern = GRBG;
-            } else if(second == 2) {
-                ret.cfa_pattern = GBRG;
-            } else {
-                ret.cfa_pattern = NONE;
-            }
-        } else if(first == 2) {
-            ret.cfa_pattern = BGGR;
-        } else {
-            ret.cfa_pattern = NONE;
-        }
+        read_dng_metadata(image, ret);
 
-        ret.black_level = Buffer<T>(4);
-        for(int i = 0; i < 4; ++i) {
-            ret.black_level(i) = image.black_level[i];
+        if(offset > 0) {
+            ret.buffer = Buffer<T>(reinterpret_cast<T *>(file.get() + offset), image.width, image.height);
+            ret.storage = file;
+        } else {
+            auto data = std::make_shared<std::vector<unsigned char>>(std::move(images[0].data));
+            ret.buffer = Buffer<T>(reinterpret_cast<T *>(data->data()), image.width, image.height);
+            ret.storage = data;
         }
-
-        T * data = static_cast<T *>(malloc(image.samples_per_pixel * image.width * image.height * sizeof(T)));
-        memcpy(data, &image.data[0], image.samples_per_pixel * image.width * image.height * sizeof(T));
-        Buffer<T> raw_buffer(data, image.width, image.height);
-        ret.buffer = raw_buffer.copy();
-        free(data);
     } else {
         ret.white_level = 0;
         ret.buffer = Buffer<T>(0);
@@ -84,4 +208,155 @@ Raw<T> load_dng(const char * filename) {
     return ret;
 }
 
+// DNG image processed by bands of rows while it is decoded (open_dng, stream_dng)
+template<typename T>
+struct DngStream {
+    Raw<T> raw; // metadata; the whole image in buffer when it is not decoded by bands
+    int width = 0;
+    int height = 0;
+    // tiled lossless JPEG image decoded by tile rows of tile_length rows, 0 otherwise
+    int tile_length = 0;
+    tinydng::DNGImage image;
+    std::shared_ptr<unsigned char> file;
+    size_t file_size = 0;
+};
+
+// Parses the IFDs of the image. Only tiled lossless JPEG images are decoded by bands, the others are
+// loaded here with load_dng and stream_dng hands out bands of raw.buffer.
+template<typename T>
+bool open_dng(const char * filename, DngStream<T> &stream, bool halide_thread_pool = false) {
+    std::string warn, err;
+    std::vector<tinydng::DNGImage> images;
+    std::vector<tinydng::FieldInfo> custom_fields;
+
+    stream.file = map_file(filename, stream.file_size);
+    if(stream.file && (stream.file_size >= 32) && (sizeof(T) == sizeof(unsigned short))) {
+        const unsigned short magic = *reinterpret_cast<const unsigned short *>(stream.file.get());
+        const bool swap_endian = (magic == 0x4d4d) && !tinydng::IsBigEndian();
+        if((magic == 0x4949) || (magic == 0x4d4d)) {
+            tinydng::StreamReader sr(stream.file.get(), stream.file_size, swap_endian);
+            if(sr.seek_set(4) && tinydng::ParseDNGFromMemory(sr, custom_fields, &images, &warn, &err) &&
+               (images.size() > 0) && (images[0].compression == tinydng::COMPRESSION_NEW_JPEG) &&
+               (images[0].samples_per_pixel == 1) && (images[0].tile_width > 0) && (images[0].tile_length > 0)) {
+                stream.image = images[0];
+                stream.width = stream.image.width;
+                stream.height = stream.image.height;
+                stream.tile_length = stream.image.tile_length;
+                read_dng_metadata(stream.image, stream.raw);
+                return true;
+            }
+        }
+    }
+
+    stream.file = nullptr;
+    stream.raw = load_dng<T>(filename, halide_thread_pool);
+    stream.width = stream.raw.buffer.width();
+    stream.height = (stream.raw.buffer.dimensions() > 1) ? stream.raw.buffer.height() : 0;
+    stream.tile_length = 0;
+    return stream.height > 0;
+}
+
+// Calls process(band, y, rows) on the calling thread for the bands of band_height rows from the top of the
+// image, as soon as they are decoded: band.buffer holds the rows [y - halo, y + rows + halo) of the image
+// clipped to (0, height), its min coordinate in y is the first of them, and is only valid during the call.
+// The tile rows are decoded on a thread, straight into the band (band_height is rounded up to a multiple of
+// tile_length, and to halo), and the halo rows are copied from the neighbour bands: three bands are in memory
+// instead of the whole raw image, the one processed, the one waiting for the first rows of the next one and
+// the one decoded.
+template<typename T>
+bool stream_dng(DngStream<T> &stream, int band_height, int halo,
+    const std::function<void(Raw<T> &band, int y, int rows)> &process, bool halide_thread_pool = false) {
+    const int width = stream.width;
+    const int height = stream.height;
+    Raw<T> band = stream.raw;
+    band_height = std::max(band_height, 1);
+
+    if(stream.tile_length == 0) {
+        for(int y = 0; y < height; y += band_height) {
+            const int rows = std::min(band_height, height - y);
+            const int y0 = std::max(0, y - halo);
+            const int y1 = std::min(height, y + rows + halo);
+            band.buffer = stream.raw.buffer.cropped(1, y0, y1 - y0);
+            process(band, y, rows);
+        }
+        return true;
+    }
+
+    band_height = std::max(band_height, halo);
+    band_height = (band_height + stream.tile_length - 1) / stream.tile_length * stream.tile_length;
+    const int bands = (height + band_height - 1) / band_height;
+    const int slots = 3;
+    std::vector<std::vector<T>> slot(slots, std::vector<T>(size_t(width) * (band_height + 2*halo)));
+
+    // rows of the band k in the image and position of its first row in the slot k % slots
+    auto band_y = [&](int k) { return k * band_height; };
+    auto band_rows = [&](int k) { return std::min(band_height, height - band_y(k)); };
+    auto band_top = [&](int k) { return std::min(halo, band_y(k)); };
+    auto band_bottom = [&](int k) { return std::min(halo, height - band_y(k) - band_rows(k)); };
+    auto band_data = [&](int k, int y) { return slot[k % slots].data() + size_t(width) * (y - band_y(k) + band_top(k)); };
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    int ready = 0;     // bands [0, ready) decoded with their halo
+    int processed = 0; // bands [0, processed) processed, their slot can be reused
+    bool failed = false;
+    std::string err;
+
+    tinydng::SetParallelFor(halide_thread_pool ? halide_parallel_for : nullptr);
+    std::thread decoder([&]() {
+        const int tile_length = stream.tile_length;
+        for(int k = 0; k < bands; k++) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&]() { return processed >= k - slots + 1; });
+            }
+            std::string tile_err;
+            bool ok = true;
+            for(int y = band_y(k); ok && (y < band_y(k) + band_rows(k)); y += tile_length) {
+                ok = tinydng::DecodeLosslessJPEGTileRow(reinterpret_cast<const char *>(stream.file.get()),
+                    static_cast<unsigned int>(stream.file_size), stream.image, y / tile_length,
+                    reinterpret_cast<unsigned short *>(band_data(k, y)), width, &tile_err);
+            }
+            if(ok && (k > 0)) {
+                // halo of the band k above it, and of the band k - 1 below it
+                memcpy(band_data(k, band_y(k) - band_top(k)), band_data(k - 1, band_y(k) - band_top(k)),
+                    sizeof(T) * width * band_top(k));
+                memcpy(band_data(k - 1, band_y(k)), band_data(k, band_y(k)), sizeof(T) * width * band_bottom(k - 1));
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if(!ok) {
+                failed = true;
+                err = tile_err;
+                cv.notify_all();
+                return;
+            }
+            ready = (k == bands - 1) ? bands : k;
+            cv.notify_all();
+        }
+    });
+
+    for(int k = 0; k < bands; k++) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]() { return failed || (ready > k); });
+            if(failed) {
+                break;
+            }
+        }
+        const int y0 = band_y(k) - band_top(k);
+        band.buffer = Buffer<T>(band_data(k, y0), width, band_top(k) + band_rows(k) + band_bottom(k));
+        band.buffer.set_min(0, y0);
+        process(band, band_y(k), band_rows(k));
+        std::lock_guard<std::mutex> lock(mutex);
+        processed = k + 1;
+        cv.notify_all();
+    }
+    decoder.join();
+
+    if(failed) {
+        std::cout << "Error: " << err;
+    }
+    return !failed;
+}
+
 #endif
@@ -1,18 +1,94 @@
 #ifndef __READ_METADATA__
 #define __READ_METADATA__
 
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
 #include "HalideBuffer.h"
+#include "halide_image_io.h"
+#include "dng_io.h"
 
 namespace {
     using namespace Halide::Runtime;
 
-    void read_metadata(const char * path, Buffer<float> & wb, Buffer<float> & ccm) {
-        int ret;
+    // white balance and ccm from the .txt of scripts/extract_metadata.py
+    bool read_metadata(const char * path, Buffer<float> & wb, Buffer<float> & ccm) {
         FILE *f = fopen(path, "r");
-        ret = fscanf(f, "%f %f %f", &wb(0), &wb(1), &wb(2));
+        if(f == nullptr) {
+            printf("could not open %s\n", path);
+            return false;
+        }
+        int n = fscanf(f, "%f %f %f", &wb(0), &wb(1), &wb(2));
         for(int i = 0; i < 3; ++i)
-            ret = fscanf(f, "%f %f %f", &ccm(0,i), &ccm(1,i), &ccm(2,i));
+            n += fscanf(f, "%f %f %f", &ccm(0,i), &ccm(1,i), &ccm(2,i));
         fclose(f);
+        if(n != 12) {
+            printf("could not read the white balance and the ccm from %s\n", path);
+            return false;
+        }
+        return true;
+    }
+
+    // Calibration container (.cal) of scripts/pack_calibration.py, little endian: the header, then the
+    // lens shading map as float (lsc_width, lsc_height, lsc_channels) with x fastest, the layout of the .mat
+    // (load_image). The levels and the CFA pattern are not stored, they come from the DNG.
+    struct CalibrationHeader {
+        char magic[4];          // HCAL
+        uint32_t version;
+        float wb[3];
+        float ccm[9];           // ccm(x, y), x fastest (rows of the .txt)
+        uint32_t lsc_width;
+        uint32_t lsc_height;
+        uint32_t lsc_channels;
+    };
+    static_assert(sizeof(CalibrationHeader) == 68, "CalibrationHeader must match scripts/pack_calibration.py");
+
+    const uint32_t calibration_version = 2;
+
+    // The buffers of a container point to its mapping (storage)
+    struct Calibration {
+        Buffer<float> wb;
+        Buffer<float> ccm;
+        Buffer<float> lsc_map;
+        std::shared_ptr<void> storage;
+    };
+
+    bool read_calibration(const char * path, Calibration & calibration) {
+        size_t size;
+        std::shared_ptr<unsigned char> file = map_file(path, size);
+        if(!file || (size < sizeof(CalibrationHeader))) {
+            printf("could not read %s\n", path);
+            return false;
+        }
+        CalibrationHeader * header = reinterpret_cast<CalibrationHeader *>(file.get());
+        const size_t lsc_size = size_t(header->lsc_width) * header->lsc_height * header->lsc_channels;
+        if((memcmp(header->magic, "HCAL", 4) != 0) || (header->version != calibration_version) ||
+           (lsc_size == 0) || (size != sizeof(CalibrationHeader) + lsc_size * sizeof(float))) {
+            printf("%s is not a calibration container of version %u\n", path, calibration_version);
+            return false;
+        }
+
+        calibration.wb = Buffer<float>(header->wb, 3);
+        calibration.ccm = Buffer<float>(header->ccm, 3, 3);
+        calibration.lsc_map = Buffer<float>(reinterpret_cast<float *>(header + 1),
+            header->lsc_width, header->lsc_height, header->lsc_channels);
+        calibration.storage = file;
+        return true;
+    }
+
+    // From the container when path_metadata is a .cal (path_lsc_map is not read), from the .mat and .txt otherwise
+    bool load_calibration(const char * path_lsc_map, const char * path_metadata, Calibration & calibration) {
+        const size_t len = strlen(path_metadata);
+        if((len > 4) && (strcmp(path_metadata + len - 4, ".cal") == 0)) {
+            return read_calibration(path_metadata, calibration);
+        }
+        calibration.wb = Buffer<float>(3);
+        calibration.ccm = Buffer<float>(3, 3);
+        Buffer<float> lsc_map = Halide::Tools::load_image(path_lsc_map);
+        calibration.lsc_map = lsc_map;
+        return read_metadata(path_metadata, calibration.wb, calibration.ccm);
     }
 };
 
@@ -0,0 +1,149 @@
+#ifndef __RUN_BENCHMARK__
+#define __RUN_BENCHMARK__
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace {
+    // The runner is configured from the environment, so that the harnesses keep their arguments:
+    //  BENCHMARK_SAMPLES  number of timed runs (30 by default), after BENCHMARK_WARMUP runs (3 by default)
+    //  BENCHMARK_CPUS     CPUs the process is pinned to, e.g. "4,5,6,7" (the big cores), at its start, so that
+    //                     the threads of the Halide runtime, created later, inherit the affinity
+    //  BENCHMARK_OUTPUT   file where a line with the statistics is appended, JSON if it ends with .json, CSV otherwise
+    //  BENCHMARK_LABEL    first column of the line (e.g. the image)
+    //  HL_NUM_THREADS     threads of the Halide runtime, reported in the line
+    int env_int(const char * name, int default_value) {
+        const char * value = getenv(name);
+        return (value && *value) ? atoi(value) : default_value;
+    }
+
+    const char * env_str(const char * name) {
+        const char * value = getenv(name);
+        return value ? value : "";
+    }
+
+    void pin_cpus(const char * cpus) {
+#ifdef __linux__
+        if(*cpus == 0) {
+            return;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for(const char * p = cpus; *p; ) {
+            CPU_SET(atoi(p), &set);
+            p = strchr(p, ',');
+            if(p == nullptr) break;
+            p++;
+        }
+        if(sched_setaffinity(0, sizeof(set), &set) != 0) {
+            printf("could not pin to CPUs %s\n", cpus);
+        }
+#endif
+    }
+
+    // pins the process before main, thus before the first Halide call or load_dng starts the thread pool
+    struct PinCpusAtStart {
+        PinCpusAtStart() {
+            pin_cpus(env_str("BENCHMARK_CPUS"));
+        }
+    };
+
+    PinCpusAtStart pin_cpus_at_start;
+
+    // s as a JSON string, quoted, with " and \ (e.g. in BENCHMARK_LABEL or the names of the Funcs) and the
+    // control characters escaped
+    void print_json_string(FILE *file, const char *s) {
+        fputc('"', file);
+        for(; *s; s++) {
+            if((*s == '"') || (*s == '\\')) {
+                fprintf(file, "\\%c", *s);
+            } else if((unsigned char)*s < 0x20) {
+                fprintf(file, "\\u%04x", (unsigned char)*s);
+            } else {
+                fputc(*s, file);
+            }
+        }
+        fputc('"', file);
+    }
+
+    double percentile(const std::vector<double> &sorted, double p) {
+        const size_t i = std::min(sorted.size() - 1, size_t(std::ceil(p * sorted.size())) - 1);
+        return sorted[i];
+    }
+
+    // returns the median time in ms
+    double run_benchmark(int numel, const std::function<void()> &op) {
+        const int samples = std::max(1, env_int("BENCHMARK_SAMPLES", 30));
+        const int warmup = std::max(0, env_int("BENCHMARK_WARMUP", 3));
+        const int threads = env_int("HL_NUM_THREADS", 0);
+        const char * output = env_str("BENCHMARK_OUTPUT");
+
+        // warm the caches and start the thread pool
+        for(int i = 0; i < warmup; i++) {
+            op();
+        }
+
+        std::vector<double> times(samples); // ms
+        for(int i = 0; i < samples; i++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            op();
+            auto end = std::chrono::high_resolution_clock::now();
+            times[i] = std::chrono::duration<double, std::milli>(end - start).count();
+        }
+
+        double mean = 0.0;
+        for(double t : times) mean += t;
+        mean /= samples;
+        double var = 0.0;
+        for(double t : times) var += (t - mean) * (t - mean);
+        const double stddev = std::sqrt(var / samples);
+        std::sort(times.begin(), times.end());
+        const double tmin = times.front();
+        const double median = percentile(times, 0.5);
+        const double p90 = percentile(times, 0.9);
+        const double p99 = percentile(times, 0.99);
+
+        printf("execution time: %lf ms %lf ns per pixel\n", tmin, tmin * 1e6 / numel);
+        printf("min %lf ms median %lf ms p90 %lf ms p99 %lf ms stddev %lf ms (%d samples)\n",
+            tmin, median, p90, p99, stddev, samples);
+
+        if(*output) {
+            FILE * file = fopen(output, "a");
+            if(file == nullptr) {
+                printf("could not open %s\n", output);
+                return median;
+            }
+            const char * label = env_str("BENCHMARK_LABEL");
+            const size_t len = strlen(output);
+            if((len > 5) && (strcmp(output + len - 5, ".json") == 0)) {
+                fprintf(file, "{\"label\": ");
+                print_json_string(file, label);
+                fprintf(file, ", \"threads\": %d, \"samples\": %d, \"numel\": %d, \"min_ms\": %lf, "
+                    "\"median_ms\": %lf, \"p90_ms\": %lf, \"p99_ms\": %lf, \"stddev_ms\": %lf}\n",
+                    threads, samples, numel, tmin, median, p90, p99, stddev);
+            } else {
+                fseek(file, 0, SEEK_END);
+                if(ftell(file) == 0) {
+                    fprintf(file, "label,threads,samples,numel,min_ms,median_ms,p90_ms,p99_ms,stddev_ms\n");
+                }
+                fprintf(file, "%s,%d,%d,%d,%lf,%lf,%lf,%lf,%lf\n",
+                    label, threads, samples, numel, tmin, median, p90, p99, stddev);
+            }
+            fclose(file);
+        }
+
+        return median;
+    }
+}
+
+#endif
@@ -261,6 +261,39 @@ bool LoadDNGFromMemory(const char* mem, unsigned int size,
 bool IsDNGFromMemory(const char* mem, unsigned int size,
                        std::string* msg);
 
+///
+/// Parallel loop used to decode the tiles of lossless JPEG images: calls
+/// `fn(context, i)` for every `i` in [0, n) and returns when all are done.
+///
+typedef void (*ParallelForFunction)(int n, void (*fn)(void* context, int i),
+                                    void* context);
+
+///
+/// Replaces the parallel loop of the tile decoder, e.g. to run it in the
+/// thread pool of the application. By default the tiles are spread over
+/// std::thread workers (or decoded serially when TINY_DNG_LOADER_NO_THREAD is
+/// defined). Pass NULL to restore the default.
+///
+void SetParallelFor(ParallelForFunction func);
+
+///
+/// Decodes the tile row `tile_row` of a tiled lossless JPEG image (e.g.
+/// COMPRESSION_NEW_JPEG with `tile_width`/`tile_length`) of the DNG data `mem`:
+/// the rows [tile_row * tile_length, (tile_row + 1) * tile_length) of the image
+/// (clipped to its height) are written to `dst`, rows of `dst_width` values.
+/// `image` only needs the IFD (e.g. from a previous LoadDNGFromMemory or from
+/// parsing it alone), so that an application can process the image by bands
+/// while the next ones are decoded. The tiles of the row are decoded with the
+/// parallel loop of SetParallelFor.
+///
+/// @return true upon success.
+/// @return false upon failure and store error message into `err`.
+///
+bool DecodeLosslessJPEGTileRow(const char* mem, unsigned int size,
+                               const DNGImage& image, int tile_row,
+                               unsigned short* dst, int dst_width,
+                               std::string* err);
+
 }  // namespace tinydng
 
 #ifdef TINY_DNG_LOADER_IMPLEMENTATION
@@ -280,6 +313,13 @@ bool IsDNGFromMemory(const char* mem, unsigned int size,
 #include <chrono>
 #endif
 
+#ifndef TINY_DNG_LOADER_NO_THREAD
+// Requires C++11 feature
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#endif
+
 #ifdef __clang__
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wvariadic-macros"
@@ -493,6 +533,7 @@ int lj92_encode(uint16_t* image, int width, int height, int bitdepth,
 typedef uint8_t u8;
 typedef uint16_t u16;
 typedef uint32_t u32;
+typedef uint64_t u64;
 
 //#define SLOW_HUFF
 //#define LJ92_DEBUG
@@ -532,8 +573,9 @@ typedef struct _ljp {
   int num_huff_idx;
 #endif
   // Parse state
-  int cnt;
-  u32 b;
+  int cnt;  // Number of bits in b
+  u64 b;    // Bit buffer (the next bit is bit cnt - 1)
+  int bix;  // Next byte of data to read into b
   u16* image;
   u16* rowcache;
   u16* outrow[2];
@@ -817,6 +859,22 @@ static int extend(ljp* self, int v, int t) {
 }
 #endif
 
+#ifndef SLOW_HUFF
+// Fills b with whole bytes of data until it holds more than 56 bits. The byte
+// after 0xFF (stuffed 0x00) is skipped; after the end of data, 0s are read.
+inline static void fillbits(ljp* self, u64* b, int* cnt, int* bix) {
+  while (*cnt <= 56) {
+    u32 v = 0;
+    if (*bix < self->datalen) {
+      v = self->data[*bix];
+      *bix += (v == 0xFF) ? 2 : 1;
+    }
+    *b = (*b << 8) | v;
+    *cnt += 8;
+  }
+}
+#endif
+
 inline static int nextdiff(ljp* self, int component_idx, int Px) {
   (void)Px;
 #ifdef SLOW_HUFF
@@ -826,26 +884,16 @@ inline static int nextdiff(ljp* self, int component_idx, int Px) {
 // TINY_DNG_DPRINTF("%d %d %d %x\n",Px+diff,Px,diff,t);//,index,usedbits);
 #else
   TINY_DNG_ASSERT(component_idx <= self->num_huff_idx, "Invalid huff index.");
-  u32 b = self->b;
+  u64 b = self->b;
   int cnt = self->cnt;
+  int bix = self->bix;
   int huffbits = self->huffbits[component_idx];
-  int ix = self->ix;
-  int next;
-  while (cnt < huffbits) {
-    next = *(u16*)&self->data[ix];
-    int one = next & 0xFF;
-    int two = next >> 8;
-    b = (b << 16) | (one << 8) | two;
-    cnt += 16;
-    ix += 2;
-    if (one == 0xFF) {
-      // TINY_DNG_DPRINTF("%x %x %x %x %d\n",one,two,b,b>>8,cnt);
-      b >>= 8;
-      cnt -= 8;
-    } else if (two == 0xFF)
-      ix++;
-  }
-  int index = b >> (cnt - huffbits);
+  // One refill per value: 32 bits hold the code (<= 16 bits, decoded with one
+  // lookup in hufflut) and the bits of the difference (<= 16).
+  if (cnt < 32) {
+    fillbits(self, &b, &cnt, &bix);
+  }
+  int index = static_cast<int>((b >> (cnt - huffbits)) & ((1u << huffbits) - 1));
   // TINY_DNG_DPRINTF("component_idx = %d / %d, index = %d\n", component_idx,
   // self->components, index);
 
@@ -854,32 +902,22 @@ inline static int nextdiff(ljp* self, int component_idx, int Px) {
   int t = ssssused >> 8;
   self->sssshist[t]++;
   cnt -= usedbits;
-  int keepbitsmask = (1 << cnt) - 1;
-  b &= keepbitsmask;
-  while (cnt < t) {
-    next = *(u16*)&self->data[ix];
-    int one = next & 0xFF;
-    int two = next >> 8;
-    b = (b << 16) | (one << 8) | two;
-    cnt += 16;
-    ix += 2;
-    if (one == 0xFF) {
-      b >>= 8;
-      cnt -= 8;
-    } else if (two == 0xFF)
-      ix++;
-  }
-  cnt -= t;
-  int diff = b >> cnt;
-  int vt = 1 << (t - 1);
-  if (diff < vt) {
-    vt = (-1 << t) + 1;
-    diff += vt;
+  int diff = 0;
+  if (t > 0) {
+    cnt -= t;
+    diff = static_cast<int>((b >> cnt) & ((1u << t) - 1));
+    int vt = 1 << (t - 1);
+    if (diff < vt) {
+      vt = (-1 << t) + 1;
+      diff += vt;
+    }
   }
-  keepbitsmask = (1 << cnt) - 1;
-  self->b = b & keepbitsmask;
+  self->b = b;
   self->cnt = cnt;
-  self->ix = ix;
+  self->bix = bix;
+  // Bytes consumed so far: the ones still in b are not counted, so that the
+  // checks of ix against datalen are not affected by the read ahead.
+  self->ix = bix - (cnt >> 3);
 // TINY_DNG_DPRINTF("%d %d\n",t,diff);
 // TINY_DNG_DPRINTF("%d %d %d %x %x %d\n",Px+diff,Px,diff,t,index,usedbits);
 #ifdef LJ92_DEBUG
@@ -896,6 +934,7 @@ static int parsePred6(ljp* self) {
   self->ix += BEH(self->data[self->ix]);
   self->cnt = 0;
   self->b = 0;
+  self->bix = self->ix;
   int write = self->writelen;
   // Now need to decode huffman coded values
   int c = 0;
@@ -1016,6 +1055,7 @@ static int parseScan(ljp* self) {
   self->ix += BEH(self->data[self->ix]);
   self->cnt = 0;
   self->b = 0;
+  self->bix = self->ix;
   // int write = self->writelen;
   // Now need to decode huffman coded values
   // int c = 0;
@@ -2716,11 +2756,206 @@ static bool DecompressZIPedTile(const StreamReader& sr, unsigned char* dst_data,
 #endif
 
 // Decompress LosslesJPEG adta.
+#ifndef TINY_DNG_LOADER_NO_THREAD
+static void ThreadParallelFor(int n, void (*fn)(void* context, int i),
+                              void* context) {
+  const int num_threads =
+      std::min(n, std::max(1, static_cast<int>(
+                                  std::thread::hardware_concurrency())));
+  std::atomic<int> next(0);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < num_threads; t++) {
+    workers.emplace_back([&]() {
+      for (int i = next++; i < n; i = next++) {
+        fn(context, i);
+      }
+    });
+  }
+  for (size_t t = 0; t < workers.size(); t++) {
+    workers[t].join();
+  }
+}
+#endif
+
+static ParallelForFunction parallel_for_func = NULL;
+
+void SetParallelFor(ParallelForFunction func) { parallel_for_func = func; }
+
+static void ParallelFor(int n, void (*fn)(void* context, int i),
+                        void* context) {
+  if (parallel_for_func) {
+    parallel_for_func(n, fn, context);
+    return;
+  }
+#ifndef TINY_DNG_LOADER_NO_THREAD
+  if (n > 1) {
+    ThreadParallelFor(n, fn, context);
+    return;
+  }
+#endif
+  for (int i = 0; i < n; i++) {
+    fn(context, i);
+  }
+}
+
+struct LosslessJPEGTile {
+  int offset;      // to the JPEG data of the tile
+  unsigned int x;  // position of the tile in the image
+  unsigned int y;
+};
+
+struct LosslessJPEGTiles {
+  const StreamReader* sr;
+  unsigned short* dst_data;
+  int dst_width;
+  unsigned int dst_y;  // row of the image at dst_data
+  const DNGImage* image_info;
+  std::vector<LosslessJPEGTile> tiles;
+#ifndef TINY_DNG_LOADER_NO_THREAD
+  std::atomic<int> failed;
+#else
+  int failed;
+#endif
+};
+
+// Decodes the tile i of context (LosslessJPEGTiles). A tile inside the image
+// is decoded straight into dst_data (rows of tile_width values, dst_width
+// apart, from the row dst_y of the image), a tile crossing the border of the
+// image through a temporary buffer.
+static void DecompressLosslessJPEGTile(void* context, int i) {
+  LosslessJPEGTiles* tiles = static_cast<LosslessJPEGTiles*>(context);
+  const StreamReader& sr = *tiles->sr;
+  const DNGImage& image_info = *tiles->image_info;
+  const LosslessJPEGTile& tile = tiles->tiles[static_cast<size_t>(i)];
+  const unsigned int dst_width = static_cast<unsigned int>(tiles->dst_width);
+  const unsigned int tile_width =
+      static_cast<unsigned int>(image_info.tile_width);
+  const unsigned int tile_length =
+      static_cast<unsigned int>(image_info.tile_length);
+
+  int lj_width = 0;
+  int lj_height = 0;
+  int lj_bits = 0;
+  lj92 ljp;
+
+  if ((tile.offset <= 0) || (static_cast<size_t>(tile.offset) >= sr.size())) {
+    tiles->failed = 1;
+    return;
+  }
+  size_t input_len = sr.size() - static_cast<size_t>(tile.offset);
+
+  // @fixme { Parse LJPEG header first and set exact compressed LJPEG data
+  // length to `data_len` arg. }
+  int ret =
+      lj92_open(&ljp, reinterpret_cast<const uint8_t*>(sr.data() + tile.offset),
+                /* data_len */ static_cast<int>(input_len), &lj_width,
+                &lj_height, &lj_bits);
+  if (ret != LJ92_ERROR_NONE) {
+    tiles->failed = 1;
+    return;
+  }
+
+  if ((lj_width * ljp->components * lj_height) !=
+      image_info.tile_width * image_info.tile_length) {
+    TINY_DNG_DPRINTF("Unexpected JPEG tile size.\n");
+    lj92_close(ljp);
+    tiles->failed = 1;
+    return;
+  }
+
+  const bool inside =
+      ((lj_width * ljp->components) == image_info.tile_width) &&
+      (tile.x + tile_width <= dst_width) &&
+      (tile.y + tile_length <= static_cast<unsigned int>(image_info.height));
+  if (inside) {
+    ret = lj92_decode(ljp,
+                      tiles->dst_data + tile.x +
+                          size_t(dst_width) * (tile.y - tiles->dst_y),
+                      image_info.tile_width,
+                      static_cast<int>(dst_width - tile_width), NULL, 0);
+  } else {
+    std::vector<uint16_t> tmpbuf(
+        static_cast<size_t>(lj_width * lj_height * ljp->components));
+
+    ret = lj92_decode(ljp, tmpbuf.data(), image_info.tile_width, 0, NULL, 0);
+
+    // Copy to dest buffer.
+    // NOTE: For some DNG file, tiled image may exceed the extent of target
+    // image resolution.
+    size_t x_len = static_cast<size_t>(tile_width);
+    if ((tile.x + tile_width) >= dst_width) {
+      x_len = static_cast<size_t>(dst_width - tile.x);
+    }
+    for (unsigned int y = 0; (ret == LJ92_ERROR_NONE) && (y < tile_length);
+         y++) {
+      unsigned int y_offset = y + tile.y;
+      if (y_offset >= static_cast<unsigned int>(image_info.height)) {
+        break;
+      }
+
+      size_t dst_offset = tile.x + size_t(dst_width) * (y_offset - tiles->dst_y);
+      memcpy(tiles->dst_data + dst_offset,
+             tmpbuf.data() + y * static_cast<size_t>(tile_width),
+             x_len * sizeof(uint16_t));
+    }
+  }
+
+  lj92_close(ljp);
+
+  if (ret != LJ92_ERROR_NONE) {
+    tiles->failed = 1;
+  }
+}
+
+static unsigned int LosslessJPEGTilesAcross(const DNGImage& image_info) {
+  return (static_cast<unsigned int>(image_info.width) +
+          static_cast<unsigned int>(image_info.tile_width) - 1) /
+         static_cast<unsigned int>(image_info.tile_width);
+}
+
+static unsigned int LosslessJPEGTileRows(const DNGImage& image_info) {
+  return (static_cast<unsigned int>(image_info.height) +
+          static_cast<unsigned int>(image_info.tile_length) - 1) /
+         static_cast<unsigned int>(image_info.tile_length);
+}
+
+// Reads the offsets of the tiles of the tile rows [first_row, first_row +
+// rows) from the current position of sr (the TileOffsets array), with the
+// position of the tiles in the image.
+static bool ReadLosslessJPEGTiles(const StreamReader& sr,
+                                  const DNGImage& image_info,
+                                  unsigned int first_row, unsigned int rows,
+                                  std::vector<LosslessJPEGTile>* tiles,
+                                  std::string* err) {
+  const unsigned int tiles_across = LosslessJPEGTilesAcross(image_info);
+  tiles->resize(tiles_across * rows);
+
+  for (size_t i = 0; i < tiles->size(); i++) {
+    // Read offset to JPEG data location.
+    int offset = 0;
+    if (!sr.read4(&offset)) {
+      if (err) {
+        (*err) +=
+            "Failed to read offset to JPEG data location in "
+            "DecompressLosslessJPEG.\n";
+      }
+      return false;
+    }
+    TINY_DNG_DPRINTF("offt = %d\n", offset);
+
+    (*tiles)[i].offset = offset;
+    (*tiles)[i].x = static_cast<unsigned int>(i % tiles_across) *
+                    static_cast<unsigned int>(image_info.tile_width);
+    (*tiles)[i].y = (first_row + static_cast<unsigned int>(i / tiles_across)) *
+                    static_cast<unsigned int>(image_info.tile_length);
+  }
+  return true;
+}
+
 static bool DecompressLosslessJPEG(const StreamReader& sr,
                                    unsigned short* dst_data, int dst_width,
                                    const DNGImage& image_info,
                                    std::string* err) {
-  unsigned int tiff_h = 0, tiff_w = 0;
   int offset = 0;
 
 #ifdef TINY_DNG_LOADER_PROFILING
@@ -2750,111 +2985,29 @@ static bool DecompressLosslessJPEG(const StreamReader& sr,
     // TINY_DNG_DPRINTF("tile = %d, %d\n", image_info.tile_width,
     // image_info.tile_length);
 
-    // Currently we only support tile data for tile.length == tiff.height.
-    // assert(image_info.tile_length == image_info.height);
-
-    size_t column_step = 0;
-    while (tiff_h < static_cast<unsigned int>(image_info.height)) {
-      // Read offset to JPEG data location.
-      if (!sr.read4(&offset)) {
-        if (err) {
-          (*err) +=
-              "Failed to read offset to JPEG data location in "
-              "DecompressLosslessJPEG.\n";
-        }
-        return false;
-      }
-      TINY_DNG_DPRINTF("offt = %d\n", offset);
-
-      int lj_width = 0;
-      int lj_height = 0;
-      int lj_bits = 0;
-      lj92 ljp;
-
-      size_t input_len = sr.size() - static_cast<size_t>(offset);
-
-      // @fixme { Parse LJPEG header first and set exact compressed LJPEG data
-      // length to `data_len` arg. }
-      int ret =
-          lj92_open(&ljp, reinterpret_cast<const uint8_t*>(sr.data() + offset),
-                    /* data_len */ static_cast<int>(input_len), &lj_width,
-                    &lj_height, &lj_bits);
-      TINY_DNG_DPRINTF("ret = %d\n", ret);
-      TINY_DNG_ASSERT(ret == LJ92_ERROR_NONE, "Error opening JPEG stream.");
-
-      // TINY_DNG_DPRINTF("lj %d, %d, %d\n", lj_width, lj_height, lj_bits);
-      // TINY_DNG_DPRINTF("ljp x %d, y %d, c %d\n", ljp->x, ljp->y,
-      // ljp->components);
-      // TINY_DNG_DPRINTF("tile width = %d\n", image_info.tile_width);
-      // TINY_DNG_DPRINTF("tile height = %d\n", image_info.tile_length);
-      // TINY_DNG_DPRINTF("col = %d, tiff_w = %d / %d\n", column_step, tiff_w,
-      // image_info.width);
-
-      TINY_DNG_ASSERT((lj_width * ljp->components * lj_height) ==
-                          image_info.tile_width * image_info.tile_length,
-                      "Unexpected JPEG tile size.");
-
-      // int write_length = image_info.tile_width;
-      // int skip_length = dst_width - image_info.tile_width;
-      // TINY_DNG_DPRINTF("write_len = %d, skip_len = %d\n", write_length,
-      // skip_length);
-
-      // size_t dst_offset =
-      //    column_step * static_cast<size_t>(image_info.tile_width) +
-      //    static_cast<unsigned int>(dst_width) * tiff_h;
-
-      // Decode into temporary buffer.
-
-      std::vector<uint16_t> tmpbuf;
-      tmpbuf.resize(
-          static_cast<size_t>(lj_width * lj_height * ljp->components));
-
-      ret = lj92_decode(ljp, tmpbuf.data(), image_info.tile_width, 0, NULL, 0);
-      TINY_DNG_ASSERT(ret == LJ92_ERROR_NONE, "Error decoding JPEG stream.");
-      // ret = lj92_decode(ljp, dst_data + dst_offset, write_length,
-      // skip_length,
-      //                  NULL, 0);
-
-      // Copy to dest buffer.
-      // NOTE: For some DNG file, tiled image may exceed the extent of target
-      // image resolution.
-      for (unsigned int y = 0;
-           y < static_cast<unsigned int>(image_info.tile_length); y++) {
-        unsigned int y_offset = y + tiff_h;
-        if (y_offset >= static_cast<unsigned int>(image_info.height)) {
-          continue;
-        }
-
-        size_t dst_offset =
-            tiff_w + static_cast<unsigned int>(dst_width) * y_offset;
-
-        size_t x_len = static_cast<size_t>(image_info.tile_width);
-        if ((tiff_w + static_cast<unsigned int>(image_info.tile_width)) >=
-            static_cast<unsigned int>(dst_width)) {
-          x_len = static_cast<size_t>(dst_width) - tiff_w;
-        }
-        for (size_t x = 0; x < x_len; x++) {
-          dst_data[dst_offset + x] =
-              tmpbuf[y * static_cast<size_t>(image_info.tile_width) + x];
-        }
-      }
-
-      TINY_DNG_ASSERT(ret == LJ92_ERROR_NONE,
-                      "Error opening JPEG stream.");  // @fixme: redundant?
+    // Tiles are independent bitstreams: read all the offsets first, then
+    // decode the tiles in parallel, each one at its position in dst_data.
+    LosslessJPEGTiles tiles;
+    tiles.sr = &sr;
+    tiles.dst_data = dst_data;
+    tiles.dst_width = dst_width;
+    tiles.dst_y = 0;
+    tiles.image_info = &image_info;
+    tiles.failed = 0;
+
+    if (!ReadLosslessJPEGTiles(sr, image_info, 0, LosslessJPEGTileRows(image_info),
+                               &tiles.tiles, err)) {
+      return false;
+    }
 
-      lj92_close(ljp);
+    ParallelFor(static_cast<int>(tiles.tiles.size()),
+                DecompressLosslessJPEGTile, &tiles);
 
-      tiff_w += static_cast<unsigned int>(image_info.tile_width);
-      column_step++;
-      // TINY_DNG_DPRINTF("col = %d, tiff_w = %d / %d\n", column_step, tiff_w,
-      // image_info.width);
-      if (tiff_w >= static_cast<unsigned int>(image_info.width)) {
-        // tiff_h += static_cast<unsigned int>(image_info.tile_length);
-        tiff_h += static_cast<unsigned int>(image_info.tile_length);
-        // TINY_DNG_DPRINTF("tiff_h = %d\n", tiff_h);
-        tiff_w = 0;
-        column_step = 0;
+    if (tiles.failed) {
+      if (err) {
+        (*err) += "Failed to decode a JPEG tile in DecompressLosslessJPEG.\n";
       }
+      return false;
     }
   } else {
     // Assume LJPEG data is not stored in tiled format.
@@ -4751,6 +4904,57 @@ bool LoadDNGFromMemory(const char* mem, unsigned int size,
   return ret ? true : false;
 }
 
+bool DecodeLosslessJPEGTileRow(const char* mem, unsigned int size,
+                               const DNGImage& image, int tile_row,
+                               unsigned short* dst, int dst_width,
+                               std::string* err) {
+  if ((mem == NULL) || (size < 32) || (dst == NULL) ||
+      (image.tile_width <= 0) || (image.tile_length <= 0) ||
+      (image.tile_offset == 0) || (tile_row < 0) ||
+      (static_cast<unsigned int>(tile_row) >= LosslessJPEGTileRows(image))) {
+    if (err) {
+      (*err) += "Invalid argument to DecodeLosslessJPEGTileRow.\n";
+    }
+    return false;
+  }
+
+  const unsigned short magic = *(reinterpret_cast<const unsigned short*>(mem));
+  const bool swap_endian = (magic == 0x4d4d) && (!IsBigEndian());
+  StreamReader sr(reinterpret_cast<const uint8_t*>(mem), size, swap_endian);
+
+  const unsigned int row = static_cast<unsigned int>(tile_row);
+  if (!sr.seek_set(image.tile_offset +
+                   4 * uint64_t(row) * LosslessJPEGTilesAcross(image))) {
+    if (err) {
+      (*err) += "Failed to seek to the offsets of the tile row.\n";
+    }
+    return false;
+  }
+
+  LosslessJPEGTiles tiles;
+  tiles.sr = &sr;
+  tiles.dst_data = dst;
+  tiles.dst_width = dst_width;
+  tiles.dst_y = row * static_cast<unsigned int>(image.tile_length);
+  tiles.image_info = &image;
+  tiles.failed = 0;
+
+  if (!ReadLosslessJPEGTiles(sr, image, row, 1, &tiles.tiles, err)) {
+    return false;
+  }
+
+  ParallelFor(static_cast<int>(tiles.tiles.size()), DecompressLosslessJPEGTile,
+              &tiles);
+
+  if (tiles.failed) {
+    if (err) {
+      (*err) += "Failed to decode a JPEG tile in DecodeLosslessJPEGTileRow.\n";
+    }
+    return false;
+  }
+  return true;
+}
+
 bool IsDNGFromMemory(const char* mem, unsigned int size,
                      std::string* msg) {
   if ((mem == NULL) || (size < 32)) {
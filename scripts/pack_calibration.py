@@ -0,0 +1,34 @@
+import struct
+import numpy as np
+from scipy import io
+
+# Calibration container read by read_calibration (include/read_metadata.hpp), little endian:
+# header (68 bytes), then the lens shading map as float32 with x fastest, then y, then the channel.
+# The levels and the CFA pattern are read from the DNG by load_dng.
+CALIBRATION_MAGIC = b'HCAL'
+CALIBRATION_VERSION = 2
+
+def read_txt(path_txt):
+    with open(path_txt) as txt:
+        values = [float(v) for v in txt.read().split()]
+    if len(values) != 12:
+        raise ValueError('%s: expected 12 values (wb and ccm), got %d' % (path_txt, len(values)))
+    return values[:3], values[3:]
+
+def pack_calibration(path_mat, path_txt, path_cal):
+    wb, ccm = read_txt(path_txt)
+    # load_image of the .mat keeps its dimensions, first one fastest (column-major): same buffer here
+    lsc = io.loadmat(path_mat)['lens_shading_map']
+    width, height, channels = lsc.shape
+    with open(path_cal, 'wb') as cal:
+        cal.write(struct.pack('<4sI3f9f3I', CALIBRATION_MAGIC, CALIBRATION_VERSION, *wb, *ccm,
+            width, height, channels))
+        cal.write(lsc.astype('<f4').tobytes(order='F'))
+
+for dng in [
+    '5a9e_20150405_165352_614',
+    '6G7M_20150307_175028_814',
+    'IMG_20200508_202014675',
+    'IMG_20201009_123817328'
+    ]:
+    pack_calibration('images/%s.mat'%dng, 'images/%s.txt'%dng, 'images/%s.cal'%dng)